@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""
+test_long_game.py — UCI regression test for long game move lists (v2.4_engine)
+
+Every game move in "position ... moves ..." goes through make_move(), which
+pushes an undo record. A game longer than the undo stack used to write past
+it and corrupt the board state behind it.
+
+Each case plays a knight shuffle (Nf3 Nf6 Ng1 Ng8 ...) so the final board is
+the start position again, then checks that the engine still agrees with a
+fresh start position:
+
+  - perft 3 gives 8902 nodes
+  - "eval" matches the start position's eval
+  - "go depth 6" returns one of the 20 legal first moves
+  - the engine still answers isready
+
+Usage:
+    python3 engine/test_long_game.py [path/to/v2.4_engine]
+
+Exit code: 0 if all tests pass, 1 if any failure.
+"""
+
+import os
+import queue
+import subprocess
+import sys
+import threading
+import time
+
+ENGINE_PATH = (
+    sys.argv[1]
+    if len(sys.argv) > 1
+    else os.path.join(os.path.dirname(os.path.abspath(__file__)), "v2.4_engine")
+)
+
+START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+SHUFFLE = ["g1f3", "g8f6", "f3g1", "f6g8"]
+START_MOVES = {
+    "a2a3", "a2a4", "b2b3", "b2b4", "c2c3", "c2c4", "d2d3", "d2d4",
+    "e2e3", "e2e4", "f2f3", "f2f4", "g2g3", "g2g4", "h2h3", "h2h4",
+    "b1a3", "b1c3", "g1f3", "g1h3",
+}
+
+# (label, position command prefix, plies) — plies is a multiple of 4
+CASES = [
+    ("startpos, 300 plies", "position startpos", 300),
+    ("fen, 300 plies", "position fen " + START_FEN, 300),
+    ("startpos, 600 plies", "position startpos", 600),
+]
+
+
+# ── Engine wrapper ─────────────────────────────────────────────────────────────
+
+class Engine:
+    """Thin subprocess wrapper for raw UCI communication."""
+
+    def __init__(self, path):
+        self.proc = subprocess.Popen(
+            [path],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            text=True,
+            bufsize=1,
+        )
+        self._q = queue.Queue()
+        self._reader = threading.Thread(target=self._read_loop, daemon=True)
+        self._reader.start()
+
+    def _read_loop(self):
+        for line in self.proc.stdout:
+            self._q.put(line.rstrip())
+        self._q.put(None)  # EOF sentinel
+
+    def send(self, cmd):
+        try:
+            self.proc.stdin.write(cmd + "\n")
+            self.proc.stdin.flush()
+        except (BrokenPipeError, OSError):
+            pass  # engine died; the next wait_for() reports it
+
+    def wait_for(self, prefix, timeout=10.0):
+        """Return the first line starting with prefix, or None on timeout/EOF."""
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            try:
+                line = self._q.get(timeout=max(0.1, deadline - time.time()))
+            except queue.Empty:
+                return None
+            if line is None:
+                return None
+            if line.lstrip().startswith(prefix):
+                return line.strip()
+        return None
+
+    def ready(self):
+        self.send("isready")
+        return self.wait_for("readyok", timeout=5.0) is not None
+
+    def quit(self):
+        try:
+            self.send("quit")
+            self.proc.wait(timeout=5)
+        except Exception:
+            self.proc.kill()
+
+
+def probe(engine, position_cmd):
+    """Return (perft nodes, eval, bestmove) for a position command."""
+    engine.send("ucinewgame")
+    engine.send(position_cmd)
+    engine.send("perft 3")
+    nodes = engine.wait_for("Nodes:")
+    engine.send("eval")
+    ev = engine.wait_for("eval:")
+    engine.send("go depth 6")
+    bm = engine.wait_for("bestmove", timeout=30.0)
+    return (
+        nodes.split()[-1] if nodes else None,
+        ev.split()[-1] if ev else None,
+        bm.split()[1] if bm and len(bm.split()) > 1 else None,
+    )
+
+
+def main():
+    if not os.path.exists(ENGINE_PATH):
+        print(f"Engine not found: {ENGINE_PATH}")
+        return 1
+
+    engine = Engine(ENGINE_PATH)
+    engine.send("uci")
+    engine.wait_for("uciok", timeout=5.0)
+
+    _, ref_eval, _ = probe(engine, "position startpos")
+    failures = 0
+
+    for label, prefix, plies in CASES:
+        moves = " ".join(SHUFFLE[i % 4] for i in range(plies))
+        nodes, ev, bm = probe(engine, f"{prefix} moves {moves}")
+        alive = engine.ready()
+
+        problems = []
+        if nodes != "8902":
+            problems.append(f"perft 3 = {nodes}, expected 8902")
+        if ev != ref_eval:
+            problems.append(f"eval = {ev}, expected {ref_eval}")
+        if bm not in START_MOVES:
+            problems.append(f"bestmove {bm} is not a legal first move")
+        if not alive:
+            problems.append("no readyok")
+
+        if problems:
+            failures += 1
+            print(f"FAIL  {label}: " + "; ".join(problems))
+        else:
+            print(f"PASS  {label}")
+
+        if not alive:
+            break
+
+    engine.quit()
+    print(f"\n{len(CASES) - failures}/{len(CASES)} passed")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
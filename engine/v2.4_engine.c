@@ -3,16 +3,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 #include <math.h>
+#include <time.h>
 #include <unistd.h>
 #include <pthread.h>
 #ifndef TUNER
 #include "fathom.h"
 #endif
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
 #ifdef WIN64
     #include <windows.h>
+    #include <malloc.h>
 #else
     # include <sys/time.h>
+    # include <sys/mman.h>
 #endif
 
 // define bitboard data type
@@ -41,6 +48,9 @@ enum {
 // encode pieces
 enum { P, N, B, R, Q, K, p, n, b, r, q, k };
 
+// v2.4: empty square in the board[] mailbox
+#define NO_PIECE -1
+
 // sides to move (colors)
 enum { white, black, both };
 
@@ -218,56 +228,131 @@ char promoted_pieces[] = {
 
 */
 
-// Lazy SMP: number of search threads
+// Lazy SMP: number of search threads (1 .. max_threads)
 int num_threads = 1;
-#define MAX_THREADS 8
 
-// Master board state — copied to each worker thread at search start
-static U64  master_bitboards[12];
-static U64  master_occupancies[3];
-static int  master_side, master_enpassant, master_castle;
-static U64  master_hash_key;
-static U64  master_repetition_table[1000];
-static int  master_repetition_index;
-static int  master_ply;
-static int  master_has_castled[2];
-static int  master_fullmove_number;
-static int  master_halfmove_clock;
+// Upper bound for the Threads option: the machine's hardware concurrency (never
+// below the old fixed limit of 8), capped at THREADS_LIMIT. Set by init_all().
+#define THREADS_LIMIT 1024
+int max_threads = 8;
+
+static int hardware_threads(void)
+{
+#ifdef WIN64
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// v2.4: Undo record pushed by make_move() and popped by unmake_move(). Only what
+// the move cannot reproduce is stored; bitboards and occupancies are restored
+// incrementally from the move itself.
+typedef struct {
+    int move;
+    int captured;        // piece taken on the target square (NO_PIECE: none / en passant)
+    int enpassant;
+    int castle;
+    int halfmove_clock;
+    int fullmove_number;
+    int has_castled;     // has_castled[] of the side that moved
+    int material, phase, pst_mg, pst_eg;
+    U64 hash_key;
+    U64 pawn_key;
+} undo_info;
+
+// Sized like repetition_table so even a whole game fits, though parse_position()
+// empties it after every game move (those are never unmade) and a search only
+// needs max ply on top of that. Pushes past the end are caught by an assert.
+#define UNDO_STACK_SIZE 1000
+
+// v2.4: Board state. Everything make_move()/unmake_move() touch lives in one
+// struct passed by pointer, so a thread can own any number of positions: each
+// search thread works on its own copy of the root and the tuner uses a local one.
+typedef struct {
+    // piece bitboards
+    U64 bitboards[12];
 
-// piece bitboards
-__thread U64 bitboards[12];
+    // occupancy bitboards
+    U64 occupancies[3];
 
-// occupancy bitboards
-__thread U64 occupancies[3];
+    // piece on each square (NO_PIECE if empty), kept in sync with bitboards
+    int board[64];
 
+    // side to move
+    int side;
 
-// side to move
-__thread int side;
+    // enpassant square
+    int enpassant;
 
-// enpassant square
-__thread int enpassant;
+    // castling rights
+    int castle;
 
-// castling rights
-__thread int castle;
+    // "almost" unique position identifier aka hash key or position key
+    U64 hash_key;
 
-// "almost" unique position identifier aka hash key or position key
-__thread U64 hash_key;
+    // v2.4: Zobrist key of the pawns alone (pawn hash table index)
+    U64 pawn_key;
 
-// positions repetition table
-__thread U64 repetition_table[1000];  // 1000 is a number of plies (500 moves) in the entire game
+    // positions repetition table
+    U64 repetition_table[1000];  // 1000 is a number of plies (500 moves) in the entire game
 
-// repetition index
-__thread int repetition_index;
+    // repetition index
+    int repetition_index;
 
-// half move counter
-__thread int ply;
+    // v12 additions: castling tracking and fullmove number
+    int has_castled[2]; // has_castled[white], has_castled[black]
+    int fullmove_number;
+
+    // v16: halfmove clock for 50-move rule
+    int halfmove_clock;
+
+    // v2.4: running evaluation terms, white minus black, kept by make_move()
+    int material;        // piece values
+    int phase;           // game phase weight of all pieces (not capped at TOTAL_PHASE)
+    int pst_mg, pst_eg;  // middlegame / endgame piece-square sums
+
+    // make_move() undo records
+    undo_info undo_stack[UNDO_STACK_SIZE];
+    int undo_count;
+} position;
 
-// v12 additions: castling tracking and fullmove number
-__thread int has_castled[2]; // has_castled[white], has_castled[black]
-__thread int fullmove_number;
+// v2.4: Per-piece values behind position.material / phase / pst_mg / pst_eg.
+// Black entries are negated and read through mirror_score; the tables are
+// filled from tp[] by init_piece_square_tables().
+int piece_material[12];
+int piece_square_mg[12][64];
+int piece_square_eg[12][64];
+const int phase_weight[12] = { 0, 1, 1, 2, 4, 0, 0, 1, 1, 2, 4, 0 };
 
-// v16: halfmove clock for 50-move rule
-__thread int halfmove_clock;
+// add / remove / move a piece in the running evaluation terms
+static inline void eval_add_piece(position *pos, int piece, int square)
+{
+    pos->material += piece_material[piece];
+    pos->phase += phase_weight[piece];
+    pos->pst_mg += piece_square_mg[piece][square];
+    pos->pst_eg += piece_square_eg[piece][square];
+}
+
+static inline void eval_remove_piece(position *pos, int piece, int square)
+{
+    pos->material -= piece_material[piece];
+    pos->phase -= phase_weight[piece];
+    pos->pst_mg -= piece_square_mg[piece][square];
+    pos->pst_eg -= piece_square_eg[piece][square];
+}
+
+static inline void eval_move_piece(position *pos, int piece, int source_square, int target_square)
+{
+    pos->pst_mg += piece_square_mg[piece][target_square] - piece_square_mg[piece][source_square];
+    pos->pst_eg += piece_square_eg[piece][target_square] - piece_square_eg[piece][source_square];
+}
+
+// half move counter
+__thread int ply;
 
 // v18 SE: move excluded from the singular extension verification search (0 = none)
 __thread int se_excluded_move;
@@ -284,7 +369,7 @@ __thread int se_excluded_move;
 // exit from engine flag
 int quit = 0;
 
-// v13 search stop flag (declared here so read_input can use it, defined in search section)
+// v13 search stop flag (declared here so the UCI input thread can use it)
 volatile int v14_stopped = 0;
 int is_pondering = 0;   // set 1 on "go ... ponder", cleared by "ponderhit"
 
@@ -335,125 +420,6 @@ int get_time_ms()
     #endif
 }
 
-/*
-
-  Function to "listen" to GUI's input during search.
-  It's waiting for the user input from STDIN.
-  OS dependent.
-  
-  First Richard Allbert aka BluefeverSoftware grabbed it from somewhere...
-  And then Code Monkey King has grabbed it from VICE)
-  
-*/
-  
-int input_waiting()
-{
-    #ifndef WIN32
-        fd_set readfds;
-        struct timeval tv;
-        FD_ZERO (&readfds);
-        FD_SET (fileno(stdin), &readfds);
-        tv.tv_sec=0; tv.tv_usec=0;
-        select(16, &readfds, 0, 0, &tv);
-
-        return (FD_ISSET(fileno(stdin), &readfds));
-    #else
-        static int init = 0, pipe;
-        static HANDLE inh;
-        DWORD dw;
-
-        if (!init)
-        {
-            init = 1;
-            inh = GetStdHandle(STD_INPUT_HANDLE);
-            pipe = !GetConsoleMode(inh, &dw);
-            if (!pipe)
-            {
-                SetConsoleMode(inh, dw & ~(ENABLE_MOUSE_INPUT|ENABLE_WINDOW_INPUT));
-                FlushConsoleInputBuffer(inh);
-            }
-        }
-        
-        if (pipe)
-        {
-           if (!PeekNamedPipe(inh, NULL, 0, NULL, &dw, NULL)) return 1;
-           return dw;
-        }
-        
-        else
-        {
-           GetNumberOfConsoleInputEvents(inh, &dw);
-           return dw <= 1 ? 0 : dw;
-        }
-
-    #endif
-}
-
-// read GUI/user input
-void read_input()
-{
-    // During ponder search the main thread owns stdin (blocking on fgets in parse_go).
-    // Don't race it from the ponder search thread.
-    if (is_pondering) return;
-
-    // bytes to read holder
-    int bytes;
-    
-    // GUI/user input
-    char input[256] = "", *endc;
-
-    // "listen" to STDIN
-    if (input_waiting())
-    {
-        // loop to read bytes from STDIN
-        do
-        {
-            bytes=read(fileno(stdin), input, 256);
-        }
-        while (bytes < 0);
-
-        // searches for the first occurrence of '\n'
-        endc = strchr(input,'\n');
-        if (endc) *endc=0;
-
-        if (strlen(input) > 0)
-        {
-            if (!strncmp(input, "quit", 4))
-            {
-                quit = 1;
-                stopped = 1;
-                v14_stopped = 1;
-            }
-            else if (!strncmp(input, "stop", 4))
-            {
-                stopped = 1;
-                v14_stopped = 1;
-            }
-            else if (!strncmp(input, "ponderhit", 9))
-            {
-                // Opponent played our predicted move — stop infinite ponder search.
-                // lichess-bot will immediately send "go wtime ... btime ..." next.
-                is_pondering = 0;
-                stopped = 1;
-                v14_stopped = 1;
-            }
-        }
-    }
-}
-
-// a bridge function to interact between search and GUI input
-static void communicate() {
-	// if time is up break here
-    if(timeset == 1 && get_time_ms() > stoptime) {
-		// tell engine to stop calculating
-		stopped = 1;
-	}
-	
-    // read GUI input
-	read_input();
-}
-
-
 /**********************************\
  ==================================
  
@@ -584,7 +550,7 @@ void init_random_keys()
 }
 
 // generate "almost" unique position ID aka hash key from scratch
-U64 generate_hash_key()
+U64 generate_hash_key(position *pos)
 {
     // final hash key
     U64 final_key = 0ULL;
@@ -596,7 +562,7 @@ U64 generate_hash_key()
     for (int piece = P; piece <= k; piece++)
     {
         // init piece bitboard copy
-        bitboard = bitboards[piece];
+        bitboard = pos->bitboards[piece];
         
         // loop over the pieces within a bitboard
         while (bitboard)
@@ -613,20 +579,50 @@ U64 generate_hash_key()
     }
     
     // if enpassant square is on board
-    if (enpassant != no_sq)
+    if (pos->enpassant != no_sq)
         // hash enpassant
-        final_key ^= enpassant_keys[enpassant];
+        final_key ^= enpassant_keys[pos->enpassant];
     
     // hash castling rights
-    final_key ^= castle_keys[castle];
+    final_key ^= castle_keys[pos->castle];
     
     // hash the side only if black is to move
-    if (side == black) final_key ^= side_key;
+    if (pos->side == black) final_key ^= side_key;
     
     // return generated hash key
     return final_key;
 }
 
+// v2.4: generate "almost" unique pawn structure key from scratch
+U64 generate_pawn_key(position *pos)
+{
+    // final pawn key
+    U64 final_key = 0ULL;
+    
+    // loop over both pawn bitboards
+    for (int piece = P; piece <= p; piece += p - P)
+    {
+        // init piece bitboard copy
+        U64 bitboard = pos->bitboards[piece];
+        
+        // loop over the pawns within a bitboard
+        while (bitboard)
+        {
+            // init square occupied by the pawn
+            int square = get_ls1b_index(bitboard);
+            
+            // hash pawn
+            final_key ^= piece_keys[piece][square];
+            
+            // pop LS1B
+            pop_bit(bitboard, square);
+        }
+    }
+    
+    // return generated pawn key
+    return final_key;
+}
+
 
 /**********************************\
  ==================================
@@ -672,7 +668,7 @@ void print_bitboard(U64 bitboard)
 }
 
 // print board
-void print_board()
+void print_board(position *pos)
 {
     // print offset
     printf("\n");
@@ -690,17 +686,8 @@ void print_board()
             if (!file)
                 printf("  %d ", 8 - rank);
             
-            // define piece variable
-            int piece = -1;
-            
-            // loop over all piece bitboards
-            for (int bb_piece = P; bb_piece <= k; bb_piece++)
-            {
-                // if there is a piece on current square
-                if (get_bit(bitboards[bb_piece], square))
-                    // get piece code
-                    piece = bb_piece;
-            }
+            // get piece code
+            int piece = pos->board[square];
             
             // print different piece set depending on OS
             #ifdef WIN64
@@ -718,45 +705,50 @@ void print_board()
     printf("\n     a b c d e f g h\n\n");
     
     // print side to move
-    printf("     Side:     %s\n", !side ? "white" : "black");
+    printf("     Side:     %s\n", !pos->side ? "white" : "black");
     
     // print enpassant square
-    printf("     Enpassant:   %s\n", (enpassant != no_sq) ? square_to_coordinates[enpassant] : "no");
+    printf("     Enpassant:   %s\n", (pos->enpassant != no_sq) ? square_to_coordinates[pos->enpassant] : "no");
     
     // print castling rights
-    printf("     Castling:  %c%c%c%c\n\n", (castle & wk) ? 'K' : '-',
-                                           (castle & wq) ? 'Q' : '-',
-                                           (castle & bk) ? 'k' : '-',
-                                           (castle & bq) ? 'q' : '-');
+    printf("     Castling:  %c%c%c%c\n\n", (pos->castle & wk) ? 'K' : '-',
+                                           (pos->castle & wq) ? 'Q' : '-',
+                                           (pos->castle & bk) ? 'k' : '-',
+                                           (pos->castle & bq) ? 'q' : '-');
     
     // print hash key
-    printf("     Hash key:  %llx\n\n", hash_key);
+    printf("     Hash key:  %llx\n\n", pos->hash_key);
 }
 
 // parse FEN string
-void parse_fen(char *fen)
+void parse_fen(position *pos, char *fen)
 {
     // reset board position (bitboards)
-    memset(bitboards, 0ULL, sizeof(bitboards));
+    memset(pos->bitboards, 0ULL, sizeof(pos->bitboards));
     
     // reset occupancies (bitboards)
-    memset(occupancies, 0ULL, sizeof(occupancies));
+    memset(pos->occupancies, 0ULL, sizeof(pos->occupancies));
+
+    // reset piece mailbox
+    for (int square = 0; square < 64; square++)
+        pos->board[square] = NO_PIECE;
     
     // reset game state variables
-    side = 0;
-    enpassant = no_sq;
-    castle = 0;
+    pos->side = 0;
+    pos->enpassant = no_sq;
+    pos->castle = 0;
 
     // reset v13 state
-    has_castled[0] = 0; has_castled[1] = 0;
-    fullmove_number = 1;
-    halfmove_clock = 0;
+    pos->has_castled[0] = 0; pos->has_castled[1] = 0;
+    pos->fullmove_number = 1;
+    pos->halfmove_clock = 0;
 
-    // reset repetition index
-    repetition_index = 0;
+    // reset repetition index and undo stack
+    pos->repetition_index = 0;
+    pos->undo_count = 0;
     
     // reset repetition table
-    memset(repetition_table, 0ULL, sizeof(repetition_table));
+    memset(pos->repetition_table, 0ULL, sizeof(pos->repetition_table));
     
     // loop over board ranks
     for (int rank = 0; rank < 8; rank++)
@@ -774,7 +766,8 @@ void parse_fen(char *fen)
                 int piece = char_pieces[*fen];
                 
                 // set piece on corresponding bitboard
-                set_bit(bitboards[piece], square);
+                set_bit(pos->bitboards[piece], square);
+                pos->board[square] = piece;
                 
                 // increment pointer to FEN string
                 fen++;
@@ -787,19 +780,10 @@ void parse_fen(char *fen)
                 int offset = *fen - '0';
                 
                 // define piece variable
-                int piece = -1;
-                
-                // loop over all piece bitboards
-                for (int bb_piece = P; bb_piece <= k; bb_piece++)
-                {
-                    // if there is a piece on current square
-                    if (get_bit(bitboards[bb_piece], square))
-                        // get piece code
-                        piece = bb_piece;
-                }
+                int piece = pos->board[square];
                 
                 // on empty current square
-                if (piece == -1)
+                if (piece == NO_PIECE)
                     // decrement file
                     file--;
                 
@@ -821,7 +805,7 @@ void parse_fen(char *fen)
     fen++;
     
     // parse side to move
-    (*fen == 'w') ? (side = white) : (side = black);
+    (*fen == 'w') ? (pos->side = white) : (pos->side = black);
     
     // go to parsing castling rights
     fen += 2;
@@ -831,10 +815,10 @@ void parse_fen(char *fen)
     {
         switch (*fen)
         {
-            case 'K': castle |= wk; break;
-            case 'Q': castle |= wq; break;
-            case 'k': castle |= bk; break;
-            case 'q': castle |= bq; break;
+            case 'K': pos->castle |= wk; break;
+            case 'Q': pos->castle |= wq; break;
+            case 'k': pos->castle |= bk; break;
+            case 'q': pos->castle |= bq; break;
             case '-': break;
         }
 
@@ -853,12 +837,12 @@ void parse_fen(char *fen)
         int rank = 8 - (fen[1] - '0');
         
         // init enpassant square
-        enpassant = rank * 8 + file;
+        pos->enpassant = rank * 8 + file;
     }
     
     // no enpassant square
     else
-        enpassant = no_sq;
+        pos->enpassant = no_sq;
 
     // advance fen pointer past en passant field
     while (*fen && *fen != ' ') fen++;
@@ -866,33 +850,40 @@ void parse_fen(char *fen)
     // v16: parse halfmove clock for 50-move rule
     if (*fen == ' ') {
         fen++;
-        halfmove_clock = atoi(fen);
+        pos->halfmove_clock = atoi(fen);
         while (*fen && *fen != ' ') fen++;
     }
 
     // parse fullmove number
     if (*fen == ' ') {
         fen++;
-        fullmove_number = atoi(fen);
-        if (fullmove_number < 1) fullmove_number = 1;
+        pos->fullmove_number = atoi(fen);
+        if (pos->fullmove_number < 1) pos->fullmove_number = 1;
     }
 
     // loop over white pieces bitboards
     for (int piece = P; piece <= K; piece++)
         // populate white occupancy bitboard
-        occupancies[white] |= bitboards[piece];
+        pos->occupancies[white] |= pos->bitboards[piece];
 
     // loop over black pieces bitboards
     for (int piece = p; piece <= k; piece++)
         // populate white occupancy bitboard
-        occupancies[black] |= bitboards[piece];
+        pos->occupancies[black] |= pos->bitboards[piece];
 
     // init all occupancies
-    occupancies[both] |= occupancies[white];
-    occupancies[both] |= occupancies[black];
+    pos->occupancies[both] |= pos->occupancies[white];
+    pos->occupancies[both] |= pos->occupancies[black];
+
+    // init running evaluation terms
+    pos->material = pos->phase = pos->pst_mg = pos->pst_eg = 0;
+    for (int square = 0; square < 64; square++)
+        if (pos->board[square] != NO_PIECE)
+            eval_add_piece(pos, pos->board[square], square);
 
     // init hash key
-    hash_key = generate_hash_key();
+    pos->hash_key = generate_hash_key(pos);
+    pos->pawn_key = generate_pawn_key(pos);
 
 }
 
@@ -1109,11 +1100,21 @@ U64 bishop_masks[64];
 // rook attack masks
 U64 rook_masks[64];
 
-// bishop attacks table [square][occupancies]
-U64 bishop_attacks[64][512];
+// v2.4: "fancy" slider attack tables - each square owns a slice of
+// 2^relevant_bits entries starting at its offset, instead of a fixed 512 / 4096
+// row, which shrinks the tables from 2.3 MB to 840 KB
+#define BISHOP_TABLE_SIZE 5248
+#define ROOK_TABLE_SIZE 102400
+
+// start of each square's slice in the attack tables
+int bishop_offsets[64];
+int rook_offsets[64];
 
-// rook attacks rable [square][occupancies]
-U64 rook_attacks[64][4096];
+// bishop attacks table [offset + occupancy index]
+U64 bishop_attacks[BISHOP_TABLE_SIZE];
+
+// rook attacks table [offset + occupancy index]
+U64 rook_attacks[ROOK_TABLE_SIZE];
 
 // generate pawn attacks
 U64 mask_pawn_attacks(int side, int square)
@@ -1467,9 +1468,38 @@ void init_magic_numbers()
         bishop_magic_numbers[square] = find_magic_number(square, bishop_relevant_bits[square], bishop);
 }
 
+// v2.4: index of an occupancy within a square's slice of the attack table.
+// Magic multiplication by default; built with -DUSE_PEXT -mbmi2 the relevant
+// occupancy bits are gathered with PEXT instead (fast on Intel since Haswell
+// and on AMD Zen 3+, but microcoded and much slower on Zen 1/2)
+static inline int bishop_index(int square, U64 occupancy)
+{
+#ifdef USE_PEXT
+    return (int)_pext_u64(occupancy, bishop_masks[square]);
+#else
+    occupancy &= bishop_masks[square];
+    occupancy *= bishop_magic_numbers[square];
+    return (int)(occupancy >> (64 - bishop_relevant_bits[square]));
+#endif
+}
+
+static inline int rook_index(int square, U64 occupancy)
+{
+#ifdef USE_PEXT
+    return (int)_pext_u64(occupancy, rook_masks[square]);
+#else
+    occupancy &= rook_masks[square];
+    occupancy *= rook_magic_numbers[square];
+    return (int)(occupancy >> (64 - rook_relevant_bits[square]));
+#endif
+}
+
 // init slider piece's attack tables
 void init_sliders_attacks(int bishop)
 {
+    // start of the next square's slice
+    int offset = 0;
+
     // loop over 64 board squares
     for (int square = 0; square < 64; square++)
     {
@@ -1485,36 +1515,27 @@ void init_sliders_attacks(int bishop)
         
         // init occupancy indicies
         int occupancy_indicies = (1 << relevant_bits_count);
+
+        // reserve this square's slice
+        if (bishop)
+            bishop_offsets[square] = offset;
+        else
+            rook_offsets[square] = offset;
+        offset += occupancy_indicies;
         
         // loop over occupancy indicies
         for (int index = 0; index < occupancy_indicies; index++)
         {
+            // init current occupancy variation
+            U64 occupancy = set_occupancy(index, relevant_bits_count, attack_mask);
+
             // bishop
             if (bishop)
-            {
-                // init current occupancy variation
-                U64 occupancy = set_occupancy(index, relevant_bits_count, attack_mask);
-                
-                // init magic index
-                int magic_index = (occupancy * bishop_magic_numbers[square]) >> (64 - bishop_relevant_bits[square]);
-                
-                // init bishop attacks
-                bishop_attacks[square][magic_index] = bishop_attacks_on_the_fly(square, occupancy);
-            }
+                bishop_attacks[bishop_offsets[square] + bishop_index(square, occupancy)] = bishop_attacks_on_the_fly(square, occupancy);
             
             // rook
             else
-            {
-                // init current occupancy variation
-                U64 occupancy = set_occupancy(index, relevant_bits_count, attack_mask);
-                
-                // init magic index
-                int magic_index = (occupancy * rook_magic_numbers[square]) >> (64 - rook_relevant_bits[square]);
-                
-                // init rook attacks
-                rook_attacks[square][magic_index] = rook_attacks_on_the_fly(square, occupancy);
-            
-            }
+                rook_attacks[rook_offsets[square] + rook_index(square, occupancy)] = rook_attacks_on_the_fly(square, occupancy);
         }
     }
 }
@@ -1523,56 +1544,53 @@ void init_sliders_attacks(int bishop)
 static inline U64 get_bishop_attacks(int square, U64 occupancy)
 {
     // get bishop attacks assuming current board occupancy
-    occupancy &= bishop_masks[square];
-    occupancy *= bishop_magic_numbers[square];
-    occupancy >>= 64 - bishop_relevant_bits[square];
-    
-    // return bishop attacks
-    return bishop_attacks[square][occupancy];
+    return bishop_attacks[bishop_offsets[square] + bishop_index(square, occupancy)];
 }
 
 // get rook attacks
 static inline U64 get_rook_attacks(int square, U64 occupancy)
 {
     // get rook attacks assuming current board occupancy
-    occupancy &= rook_masks[square];
-    occupancy *= rook_magic_numbers[square];
-    occupancy >>= 64 - rook_relevant_bits[square];
-    
-    // return rook attacks
-    return rook_attacks[square][occupancy];
+    return rook_attacks[rook_offsets[square] + rook_index(square, occupancy)];
 }
 
 // get queen attacks
 static inline U64 get_queen_attacks(int square, U64 occupancy)
 {
-    // init result attacks bitboard
-    U64 queen_attacks = 0ULL;
-    
-    // init bishop occupancies
-    U64 bishop_occupancy = occupancy;
-    
-    // init rook occupancies
-    U64 rook_occupancy = occupancy;
-    
-    // get bishop attacks assuming current board occupancy
-    bishop_occupancy &= bishop_masks[square];
-    bishop_occupancy *= bishop_magic_numbers[square];
-    bishop_occupancy >>= 64 - bishop_relevant_bits[square];
-    
-    // get bishop attacks
-    queen_attacks = bishop_attacks[square][bishop_occupancy];
-    
-    // get rook attacks assuming current board occupancy
-    rook_occupancy &= rook_masks[square];
-    rook_occupancy *= rook_magic_numbers[square];
-    rook_occupancy >>= 64 - rook_relevant_bits[square];
-    
-    // get rook attacks
-    queen_attacks |= rook_attacks[square][rook_occupancy];
-    
-    // return queen attacks
-    return queen_attacks;
+    return get_bishop_attacks(square, occupancy) | get_rook_attacks(square, occupancy);
+}
+
+// v2.4: squares strictly between two aligned squares, and the whole line
+// through them (both empty when the squares share no rank, file or diagonal)
+U64 between_squares[64][64];
+U64 line_through[64][64];
+
+// init between / line tables from the slider attacks
+void init_line_tables()
+{
+    for (int from = 0; from < 64; from++)
+        for (int to = 0; to < 64; to++)
+        {
+            U64 from_bit = 1ULL << from, to_bit = 1ULL << to;
+
+            if (from == to)
+                between_squares[from][to] = line_through[from][to] = 0ULL;
+
+            else if (get_bishop_attacks(from, 0ULL) & to_bit)
+            {
+                between_squares[from][to] = get_bishop_attacks(from, to_bit) & get_bishop_attacks(to, from_bit);
+                line_through[from][to] = (get_bishop_attacks(from, 0ULL) & get_bishop_attacks(to, 0ULL)) | from_bit | to_bit;
+            }
+
+            else if (get_rook_attacks(from, 0ULL) & to_bit)
+            {
+                between_squares[from][to] = get_rook_attacks(from, to_bit) & get_rook_attacks(to, from_bit);
+                line_through[from][to] = (get_rook_attacks(from, 0ULL) & get_rook_attacks(to, 0ULL)) | from_bit | to_bit;
+            }
+
+            else
+                between_squares[from][to] = line_through[from][to] = 0ULL;
+        }
 }
 
 
@@ -1585,35 +1603,35 @@ static inline U64 get_queen_attacks(int square, U64 occupancy)
 \**********************************/
 
 // is square current given attacked by the current given side
-static inline int is_square_attacked(int square, int side)
+static inline int is_square_attacked(position *pos, int square, int side)
 {
     // attacked by white pawns
-    if ((side == white) && (pawn_attacks[black][square] & bitboards[P])) return 1;
+    if ((side == white) && (pawn_attacks[black][square] & pos->bitboards[P])) return 1;
     
     // attacked by black pawns
-    if ((side == black) && (pawn_attacks[white][square] & bitboards[p])) return 1;
+    if ((side == black) && (pawn_attacks[white][square] & pos->bitboards[p])) return 1;
     
     // attacked by knights
-    if (knight_attacks[square] & ((side == white) ? bitboards[N] : bitboards[n])) return 1;
+    if (knight_attacks[square] & ((side == white) ? pos->bitboards[N] : pos->bitboards[n])) return 1;
     
     // attacked by bishops
-    if (get_bishop_attacks(square, occupancies[both]) & ((side == white) ? bitboards[B] : bitboards[b])) return 1;
+    if (get_bishop_attacks(square, pos->occupancies[both]) & ((side == white) ? pos->bitboards[B] : pos->bitboards[b])) return 1;
 
     // attacked by rooks
-    if (get_rook_attacks(square, occupancies[both]) & ((side == white) ? bitboards[R] : bitboards[r])) return 1;    
+    if (get_rook_attacks(square, pos->occupancies[both]) & ((side == white) ? pos->bitboards[R] : pos->bitboards[r])) return 1;    
 
     // attacked by bishops
-    if (get_queen_attacks(square, occupancies[both]) & ((side == white) ? bitboards[Q] : bitboards[q])) return 1;
+    if (get_queen_attacks(square, pos->occupancies[both]) & ((side == white) ? pos->bitboards[Q] : pos->bitboards[q])) return 1;
     
     // attacked by kings
-    if (king_attacks[square] & ((side == white) ? bitboards[K] : bitboards[k])) return 1;
+    if (king_attacks[square] & ((side == white) ? pos->bitboards[K] : pos->bitboards[k])) return 1;
 
     // by default return false
     return 0;
 }
 
 // print attacked squares
-void print_attacked_squares(int side)
+void print_attacked_squares(position *pos, int side)
 {
     printf("\n");
     
@@ -1631,7 +1649,7 @@ void print_attacked_squares(int side)
                 printf("  %d ", 8 - rank);
             
             // check whether current square is attacked or not
-            printf(" %d", is_square_attacked(square, side) ? 1 : 0);
+            printf(" %d", is_square_attacked(pos, square, side) ? 1 : 0);
         }
         
         // print new line every rank
@@ -1769,30 +1787,12 @@ void print_move_list(moves *move_list)
 
 }
 
-// preserve board state
-#define copy_board()                                                      \
-    U64 bitboards_copy[12], occupancies_copy[3];                          \
-    int side_copy, enpassant_copy, castle_copy;                           \
-    memcpy(bitboards_copy, bitboards, 96);                                \
-    memcpy(occupancies_copy, occupancies, 24);                            \
-    side_copy = side, enpassant_copy = enpassant, castle_copy = castle;   \
-    U64 hash_key_copy = hash_key;                                         \
-    int has_castled_copy[2]; memcpy(has_castled_copy, has_castled, 8);    \
-    int fullmove_copy = fullmove_number;                                  \
-    int halfmove_clock_copy = halfmove_clock;                             \
-
-// restore board state
-#define take_back()                                                       \
-    memcpy(bitboards, bitboards_copy, 96);                                \
-    memcpy(occupancies, occupancies_copy, 24);                            \
-    side = side_copy, enpassant = enpassant_copy, castle = castle_copy;   \
-    hash_key = hash_key_copy;                                             \
-    memcpy(has_castled, has_castled_copy, 8);                             \
-    fullmove_number = fullmove_copy;                                      \
-    halfmove_clock = halfmove_clock_copy;                                 \
-
-// move types
-enum { all_moves, only_captures };
+// move types (v2.4: legal_moves marks moves taken from the legal generator,
+// which make_move() does not need to test for king safety)
+enum { all_moves, only_captures, legal_moves };
+
+// v2.4: move sets for the legal generator
+enum { gen_all, gen_captures, gen_quiets };
 
 /*
                            castling   move     in      in
@@ -1822,15 +1822,130 @@ const int castling_rights[64] = {
     13, 15, 15, 15, 12, 15, 15, 14
 };
 
+// take back the last move made by make_move()
+static inline void unmake_move(position *pos)
+{
+    undo_info *undo = &pos->undo_stack[--pos->undo_count];
+    int move = undo->move;
+
+    // side that made the move
+    pos->side ^= 1;
+
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    int piece = get_move_piece(move);
+    int promoted_piece = get_move_promoted(move);
+    U64 from_to = (1ULL << source_square) | (1ULL << target_square);
+
+    // move piece back (a promoted piece turns back into the pawn)
+    if (promoted_piece)
+        pop_bit(pos->bitboards[promoted_piece], target_square);
+    else
+        pop_bit(pos->bitboards[piece], target_square);
+    set_bit(pos->bitboards[piece], source_square);
+    pos->occupancies[pos->side] ^= from_to;
+    pos->board[source_square] = piece;
+    pos->board[target_square] = undo->captured;
+
+    // restore captured piece
+    if (undo->captured != NO_PIECE)
+    {
+        set_bit(pos->bitboards[undo->captured], target_square);
+        pos->occupancies[pos->side ^ 1] |= 1ULL << target_square;
+    }
+
+    // restore pawn captured en passant
+    if (get_move_enpassant(move))
+    {
+        int victim_square = (pos->side == white) ? target_square + 8 : target_square - 8;
+        set_bit(pos->bitboards[(pos->side == white) ? p : P], victim_square);
+        pos->occupancies[pos->side ^ 1] |= 1ULL << victim_square;
+        pos->board[victim_square] = (pos->side == white) ? p : P;
+    }
+
+    // move castling rook back
+    if (get_move_castling(move))
+    {
+        int rook = (pos->side == white) ? R : r;
+        int rook_from, rook_to;
+        switch (target_square)
+        {
+            case (g1): rook_from = h1; rook_to = f1; break;
+            case (c1): rook_from = a1; rook_to = d1; break;
+            case (g8): rook_from = h8; rook_to = f8; break;
+            default:   rook_from = a8; rook_to = d8; break;
+        }
+        pop_bit(pos->bitboards[rook], rook_to);
+        set_bit(pos->bitboards[rook], rook_from);
+        pos->occupancies[pos->side] ^= (1ULL << rook_from) | (1ULL << rook_to);
+        pos->board[rook_to] = NO_PIECE;
+        pos->board[rook_from] = rook;
+    }
+
+    pos->occupancies[both] = pos->occupancies[white] | pos->occupancies[black];
+
+    // restore irreversible state
+    pos->enpassant = undo->enpassant;
+    pos->castle = undo->castle;
+    pos->halfmove_clock = undo->halfmove_clock;
+    pos->fullmove_number = undo->fullmove_number;
+    pos->has_castled[pos->side] = undo->has_castled;
+    pos->material = undo->material;
+    pos->phase = undo->phase;
+    pos->pst_mg = undo->pst_mg;
+    pos->pst_eg = undo->pst_eg;
+    pos->hash_key = undo->hash_key;
+    pos->pawn_key = undo->pawn_key;
+}
+
+// v2.4: pass the move to the opponent (null move pruning)
+static inline void make_null_move(position *pos)
+{
+    assert(pos->undo_count < UNDO_STACK_SIZE);
+    undo_info *undo = &pos->undo_stack[pos->undo_count++];
+    undo->enpassant = pos->enpassant;
+    undo->hash_key = pos->hash_key;
+
+    // hash out en passant
+    if (pos->enpassant != no_sq) pos->hash_key ^= enpassant_keys[pos->enpassant];
+    pos->enpassant = no_sq;
+
+    // switch side
+    pos->side ^= 1;
+    pos->hash_key ^= side_key;
+}
+
+// v2.4: take back make_null_move()
+static inline void unmake_null_move(position *pos)
+{
+    undo_info *undo = &pos->undo_stack[--pos->undo_count];
+    pos->enpassant = undo->enpassant;
+    pos->hash_key = undo->hash_key;
+    pos->side ^= 1;
+}
+
 // make move on chess board
-static inline int make_move(int move, int move_flag)
+static inline int make_move(position *pos, int move, int move_flag)
 {
     // quiet moves
-    if (move_flag == all_moves)
+    if (move_flag != only_captures)
     {
-        // preserve board state
-        copy_board();
-        
+        // preserve irreversible state
+        assert(pos->undo_count < UNDO_STACK_SIZE);
+        undo_info *undo = &pos->undo_stack[pos->undo_count++];
+        undo->move = move;
+        undo->enpassant = pos->enpassant;
+        undo->castle = pos->castle;
+        undo->halfmove_clock = pos->halfmove_clock;
+        undo->fullmove_number = pos->fullmove_number;
+        undo->has_castled = pos->has_castled[pos->side];
+        undo->material = pos->material;
+        undo->phase = pos->phase;
+        undo->pst_mg = pos->pst_mg;
+        undo->pst_eg = pos->pst_eg;
+        undo->hash_key = pos->hash_key;
+        undo->pawn_key = pos->pawn_key;
+
         // parse move
         int source_square = get_move_source(move);
         int target_square = get_move_target(move);
@@ -1840,136 +1955,134 @@ static inline int make_move(int move, int move_flag)
         int double_push = get_move_double(move);
         int enpass = get_move_enpassant(move);
         int castling = get_move_castling(move);
+
+        // piece on the target square (NO_PIECE for quiet moves and en passant)
+        int captured = pos->board[target_square];
+        undo->captured = captured;
         
         // move piece
-        pop_bit(bitboards[piece], source_square);
-        set_bit(bitboards[piece], target_square);
+        pop_bit(pos->bitboards[piece], source_square);
+        set_bit(pos->bitboards[piece], target_square);
+        pos->occupancies[pos->side] ^= (1ULL << source_square) | (1ULL << target_square);
+        pos->board[source_square] = NO_PIECE;
+        pos->board[target_square] = piece;
+        eval_move_piece(pos, piece, source_square, target_square);
         
         // hash piece
-        hash_key ^= piece_keys[piece][source_square]; // remove piece from source square in hash key
-        hash_key ^= piece_keys[piece][target_square]; // set piece to the target square in hash key
+        pos->hash_key ^= piece_keys[piece][source_square]; // remove piece from source square in hash key
+        pos->hash_key ^= piece_keys[piece][target_square]; // set piece to the target square in hash key
+        if (piece == P || piece == p)
+            pos->pawn_key ^= piece_keys[piece][source_square] ^ piece_keys[piece][target_square];
         
-        // handling capture moves
-        if (capture)
+        // handling capture moves (en passant victims are handled below)
+        if (captured != NO_PIECE)
         {
-            // pick up bitboard piece index ranges depending on side
-            int start_piece, end_piece;
-            
-            // white to move
-            if (side == white)
-            {
-                start_piece = p;
-                end_piece = k;
-            }
-            
-            // black to move
-            else
-            {
-                start_piece = P;
-                end_piece = K;
-            }
+            // remove it from corresponding bitboard
+            pop_bit(pos->bitboards[captured], target_square);
+            pos->occupancies[pos->side ^ 1] ^= 1ULL << target_square;
+            eval_remove_piece(pos, captured, target_square);
             
-            // loop over bitboards opposite to the current side to move
-            for (int bb_piece = start_piece; bb_piece <= end_piece; bb_piece++)
-            {
-                // if there's a piece on the target square
-                if (get_bit(bitboards[bb_piece], target_square))
-                {
-                    // remove it from corresponding bitboard
-                    pop_bit(bitboards[bb_piece], target_square);
-                    
-                    // remove the piece from hash key
-                    hash_key ^= piece_keys[bb_piece][target_square];
-                    break;
-                }
-            }
+            // remove the piece from hash key
+            pos->hash_key ^= piece_keys[captured][target_square];
+            if (captured == P || captured == p)
+                pos->pawn_key ^= piece_keys[captured][target_square];
         }
         
         // handle pawn promotions
         if (promoted_piece)
         {
             // white to move
-            if (side == white)
+            if (pos->side == white)
             {
                 // erase the pawn from the target square
-                pop_bit(bitboards[P], target_square);
+                pop_bit(pos->bitboards[P], target_square);
+                eval_remove_piece(pos, P, target_square);
                 
                 // remove pawn from hash key
-                hash_key ^= piece_keys[P][target_square];
+                pos->hash_key ^= piece_keys[P][target_square];
+                pos->pawn_key ^= piece_keys[P][target_square];
             }
             
             // black to move
             else
             {
                 // erase the pawn from the target square
-                pop_bit(bitboards[p], target_square);
+                pop_bit(pos->bitboards[p], target_square);
+                eval_remove_piece(pos, p, target_square);
                 
                 // remove pawn from hash key
-                hash_key ^= piece_keys[p][target_square];
+                pos->hash_key ^= piece_keys[p][target_square];
+                pos->pawn_key ^= piece_keys[p][target_square];
             }
             
             // set up promoted piece on chess board
-            set_bit(bitboards[promoted_piece], target_square);
+            set_bit(pos->bitboards[promoted_piece], target_square);
+            pos->board[target_square] = promoted_piece;
+            eval_add_piece(pos, promoted_piece, target_square);
             
             // add promoted piece into the hash key
-            hash_key ^= piece_keys[promoted_piece][target_square];
+            pos->hash_key ^= piece_keys[promoted_piece][target_square];
         }
         
         // handle enpassant captures
         if (enpass)
         {
-            // erase the pawn depending on side to move
-            (side == white) ? pop_bit(bitboards[p], target_square + 8) :
-                              pop_bit(bitboards[P], target_square - 8);
-                              
             // white to move
-            if (side == white)
+            if (pos->side == white)
             {
                 // remove captured pawn
-                pop_bit(bitboards[p], target_square + 8);
+                pop_bit(pos->bitboards[p], target_square + 8);
+                pos->occupancies[black] ^= 1ULL << (target_square + 8);
+                pos->board[target_square + 8] = NO_PIECE;
+                eval_remove_piece(pos, p, target_square + 8);
                 
                 // remove pawn from hash key
-                hash_key ^= piece_keys[p][target_square + 8];
+                pos->hash_key ^= piece_keys[p][target_square + 8];
+                pos->pawn_key ^= piece_keys[p][target_square + 8];
             }
             
             // black to move
             else
             {
                 // remove captured pawn
-                pop_bit(bitboards[P], target_square - 8);
+                pop_bit(pos->bitboards[P], target_square - 8);
+                pos->occupancies[white] ^= 1ULL << (target_square - 8);
+                pos->board[target_square - 8] = NO_PIECE;
+                eval_remove_piece(pos, P, target_square - 8);
                 
                 // remove pawn from hash key
-                hash_key ^= piece_keys[P][target_square - 8];
+                pos->hash_key ^= piece_keys[P][target_square - 8];
+                pos->pawn_key ^= piece_keys[P][target_square - 8];
             }
         }
-        
+
         // hash enpassant if available (remove enpassant square from hash key )
-        if (enpassant != no_sq) hash_key ^= enpassant_keys[enpassant];
+        if (pos->enpassant != no_sq) pos->hash_key ^= enpassant_keys[pos->enpassant];
         
         // reset enpassant square
-        enpassant = no_sq;
+        pos->enpassant = no_sq;
         
         // handle double pawn push
         if (double_push)
         {
             // white to move
-            if (side == white)
+            if (pos->side == white)
             {
                 // set enpassant square
-                enpassant = target_square + 8;
+                pos->enpassant = target_square + 8;
                 
                 // hash enpassant
-                hash_key ^= enpassant_keys[target_square + 8];
+                pos->hash_key ^= enpassant_keys[target_square + 8];
             }
             
             // black to move
             else
             {
                 // set enpassant square
-                enpassant = target_square - 8;
+                pos->enpassant = target_square - 8;
                 
                 // hash enpassant
-                hash_key ^= enpassant_keys[target_square - 8];
+                pos->hash_key ^= enpassant_keys[target_square - 8];
             }
         }
         
@@ -1982,101 +2095,101 @@ static inline int make_move(int move, int move_flag)
                 // white castles king side
                 case (g1):
                     // move H rook
-                    pop_bit(bitboards[R], h1);
-                    set_bit(bitboards[R], f1);
+                    pop_bit(pos->bitboards[R], h1);
+                    set_bit(pos->bitboards[R], f1);
+                    pos->occupancies[pos->side] ^= (1ULL << h1) | (1ULL << f1);
+                    pos->board[h1] = NO_PIECE;
+                    pos->board[f1] = R;
+                    eval_move_piece(pos, R, h1, f1);
                     
                     // hash rook
-                    hash_key ^= piece_keys[R][h1];  // remove rook from h1 from hash key
-                    hash_key ^= piece_keys[R][f1];  // put rook on f1 into a hash key
+                    pos->hash_key ^= piece_keys[R][h1];  // remove rook from h1 from hash key
+                    pos->hash_key ^= piece_keys[R][f1];  // put rook on f1 into a hash key
                     break;
                 
                 // white castles queen side
                 case (c1):
                     // move A rook
-                    pop_bit(bitboards[R], a1);
-                    set_bit(bitboards[R], d1);
+                    pop_bit(pos->bitboards[R], a1);
+                    set_bit(pos->bitboards[R], d1);
+                    pos->occupancies[pos->side] ^= (1ULL << a1) | (1ULL << d1);
+                    pos->board[a1] = NO_PIECE;
+                    pos->board[d1] = R;
+                    eval_move_piece(pos, R, a1, d1);
                     
                     // hash rook
-                    hash_key ^= piece_keys[R][a1];  // remove rook from a1 from hash key
-                    hash_key ^= piece_keys[R][d1];  // put rook on d1 into a hash key
+                    pos->hash_key ^= piece_keys[R][a1];  // remove rook from a1 from hash key
+                    pos->hash_key ^= piece_keys[R][d1];  // put rook on d1 into a hash key
                     break;
                 
                 // black castles king side
                 case (g8):
                     // move H rook
-                    pop_bit(bitboards[r], h8);
-                    set_bit(bitboards[r], f8);
+                    pop_bit(pos->bitboards[r], h8);
+                    set_bit(pos->bitboards[r], f8);
+                    pos->occupancies[pos->side] ^= (1ULL << h8) | (1ULL << f8);
+                    pos->board[h8] = NO_PIECE;
+                    pos->board[f8] = r;
+                    eval_move_piece(pos, r, h8, f8);
                     
                     // hash rook
-                    hash_key ^= piece_keys[r][h8];  // remove rook from h8 from hash key
-                    hash_key ^= piece_keys[r][f8];  // put rook on f8 into a hash key
+                    pos->hash_key ^= piece_keys[r][h8];  // remove rook from h8 from hash key
+                    pos->hash_key ^= piece_keys[r][f8];  // put rook on f8 into a hash key
                     break;
                 
                 // black castles queen side
                 case (c8):
                     // move A rook
-                    pop_bit(bitboards[r], a8);
-                    set_bit(bitboards[r], d8);
+                    pop_bit(pos->bitboards[r], a8);
+                    set_bit(pos->bitboards[r], d8);
+                    pos->occupancies[pos->side] ^= (1ULL << a8) | (1ULL << d8);
+                    pos->board[a8] = NO_PIECE;
+                    pos->board[d8] = r;
+                    eval_move_piece(pos, r, a8, d8);
                     
                     // hash rook
-                    hash_key ^= piece_keys[r][a8];  // remove rook from a8 from hash key
-                    hash_key ^= piece_keys[r][d8];  // put rook on d8 into a hash key
+                    pos->hash_key ^= piece_keys[r][a8];  // remove rook from a8 from hash key
+                    pos->hash_key ^= piece_keys[r][d8];  // put rook on d8 into a hash key
                     break;
             }
 
             // v12: mark that this side has castled
-            has_castled[side] = 1;
+            pos->has_castled[pos->side] = 1;
         }
 
         // hash castling
-        hash_key ^= castle_keys[castle];
+        pos->hash_key ^= castle_keys[pos->castle];
 
         // update castling rights
-        castle &= castling_rights[source_square];
-        castle &= castling_rights[target_square];
+        pos->castle &= castling_rights[source_square];
+        pos->castle &= castling_rights[target_square];
 
         // hash castling
-        hash_key ^= castle_keys[castle];
-
-        // reset occupancies
-        memset(occupancies, 0ULL, 24);
-
-        // loop over white pieces bitboards
-        for (int bb_piece = P; bb_piece <= K; bb_piece++)
-            // update white occupancies
-            occupancies[white] |= bitboards[bb_piece];
-
-        // loop over black pieces bitboards
-        for (int bb_piece = p; bb_piece <= k; bb_piece++)
-            // update black occupancies
-            occupancies[black] |= bitboards[bb_piece];
+        pos->hash_key ^= castle_keys[pos->castle];
 
         // update both sides occupancies
-        occupancies[both] |= occupancies[white];
-        occupancies[both] |= occupancies[black];
-
-
+        pos->occupancies[both] = pos->occupancies[white] | pos->occupancies[black];
 
         // change side
-        side ^= 1;
+        pos->side ^= 1;
 
         // hash side
-        hash_key ^= side_key;
+        pos->hash_key ^= side_key;
 
         // v12: increment fullmove number after black moves
-        if (side == white) fullmove_number++;
+        if (pos->side == white) pos->fullmove_number++;
 
         // v16: update halfmove clock for 50-move rule (reset on pawn move or capture)
         if (piece == P || piece == p || capture)
-            halfmove_clock = 0;
+            pos->halfmove_clock = 0;
         else
-            halfmove_clock++;
+            pos->halfmove_clock++;
 
         // make sure that king has not been exposed into a check
-        if (is_square_attacked((side == white) ? get_ls1b_index(bitboards[k]) : get_ls1b_index(bitboards[K]), side))
+        if (move_flag == all_moves && is_square_attacked(pos, (pos->side == white) ? get_ls1b_index(pos->bitboards[k]) : get_ls1b_index(pos->bitboards[K]), pos->side))
         {
             // take move back
-            take_back();
+            unmake_move(pos);
             
             // return illegal move
             return 0;
@@ -2095,7 +2208,7 @@ static inline int make_move(int move, int move_flag)
     {
         // make sure move is the capture
         if (get_move_capture(move))
-            make_move(move, all_moves);
+            return make_move(pos, move, all_moves);
         
         // otherwise the move is not a capture
         else
@@ -2104,427 +2217,434 @@ static inline int make_move(int move, int move_flag)
     }
 }
 
-// generate all moves
-static inline void generate_moves(moves *move_list)
+// v2.4: pieces of the given side attacking a square, sliders seen through the given occupancy
+static inline U64 attackers_of_side(position *pos, int square, int side, U64 occupancy)
+{
+    // piece offset of the attacking side (P..K or p..k)
+    int offset = side * 6;
+
+    return (pawn_attacks[side ^ 1][square] & pos->bitboards[P + offset])
+         | (knight_attacks[square] & pos->bitboards[N + offset])
+         | (king_attacks[square] & pos->bitboards[K + offset])
+         | (get_bishop_attacks(square, occupancy) & (pos->bitboards[B + offset] | pos->bitboards[Q + offset]))
+         | (get_rook_attacks(square, occupancy) & (pos->bitboards[R + offset] | pos->bitboards[Q + offset]));
+}
+
+// v2.4: pieces of either color that are the only piece between a king square
+// and a slider of the given side bearing on it (pinned pieces when the slider
+// is an enemy, discovered-check candidates when it is our own)
+static inline U64 slider_blockers(position *pos, int king_square, int slider_side)
+{
+    int offset = slider_side * 6;
+    U64 blockers = 0ULL;
+
+    // sliders that would hit the king on an empty board
+    U64 snipers = (get_bishop_attacks(king_square, 0ULL) & (pos->bitboards[B + offset] | pos->bitboards[Q + offset]))
+                | (get_rook_attacks(king_square, 0ULL) & (pos->bitboards[R + offset] | pos->bitboards[Q + offset]));
+
+    while (snipers)
+    {
+        int sniper_square = get_ls1b_index(snipers);
+        U64 between = between_squares[king_square][sniper_square] & pos->occupancies[both];
+
+        if (between && !(between & (between - 1)))
+            blockers |= between;
+
+        pop_bit(snipers, sniper_square);
+    }
+
+    return blockers;
+}
+
+// add a move to the list, flagging it as a capture when it lands on an enemy piece
+static inline void add_piece_move(moves *move_list, int source_square, int target_square, int piece, U64 enemy)
+{
+    add_move(move_list, encode_move(source_square, target_square, piece, 0, (get_bit(enemy, target_square) ? 1 : 0), 0, 0, 0));
+}
+
+// v2.4: legal move generator. Checkers and pinned pieces are computed once per
+// node: in double check only the king moves, in single check every other move
+// must capture the checker or block its ray, and pinned pieces stay on the line
+// through their king. King steps are tested with the king lifted off the board,
+// en passant by replaying the capture on the occupancy, so every generated move
+// is legal and make_move() can skip its king-safety test (legal_moves flag).
+// gen_captures emits captures (incl. en passant and capture promotions) plus
+// quiet queen promotions; gen_quiets emits the remaining moves onto empty
+// squares (pushes, all quiet promotions, castling).
+static inline void generate_legal(position *pos, moves *move_list, int gen_type)
 {
     // init move count
     move_list->count = 0;
 
     // define source & target squares
     int source_square, target_square;
-    
+
     // define current piece's bitboard copy & it's attacks
     U64 bitboard, attacks;
-    
-    // loop over all the bitboards
-    for (int piece = P; piece <= k; piece++)
+
+    // side-relative pieces and squares
+    int side = pos->side;
+    int offset = side * 6;
+    int pawn = P + offset;
+    int queen = Q + offset;
+    int push = (side == white) ? -8 : 8;
+    U64 promotion_rank = (side == white) ? 0x000000000000FF00ULL : 0x00FF000000000000ULL;
+    U64 start_rank = (side == white) ? 0x00FF000000000000ULL : 0x000000000000FF00ULL;
+    U64 own = pos->occupancies[side];
+    U64 enemy = pos->occupancies[side ^ 1];
+    U64 occupancy = pos->occupancies[both];
+    int captures_only = (gen_type == gen_captures);
+    int quiets_only = (gen_type == gen_quiets);
+    U64 targets = captures_only ? enemy : quiets_only ? ~occupancy : ~own;
+
+    // king square and the enemy pieces giving check
+    int king_square = get_ls1b_index(pos->bitboards[K + offset]);
+    U64 checkers = attackers_of_side(pos, king_square, side ^ 1, occupancy);
+
+    // king moves: with the king lifted off the board it cannot shield its own destination from a slider
+    U64 occupancy_without_king = occupancy ^ (1ULL << king_square);
+    attacks = king_attacks[king_square] & targets;
+    while (attacks)
     {
-        // init piece bitboard copy
-        bitboard = bitboards[piece];
-        
-        // generate white pawns & white king castling moves
-        if (side == white)
+        target_square = get_ls1b_index(attacks);
+
+        if (!attackers_of_side(pos, target_square, side ^ 1, occupancy_without_king))
+            add_piece_move(move_list, king_square, target_square, K + offset, enemy);
+
+        pop_bit(attacks, target_square);
+    }
+
+    // double check: only the king can move
+    if (checkers & (checkers - 1))
+        return;
+
+    // single check: capture the checker or block its ray
+    U64 check_mask = ~0ULL;
+    if (checkers)
+        check_mask = checkers | between_squares[king_square][get_ls1b_index(checkers)];
+
+    // pinned pieces: a single own piece between the king and an enemy slider on an open line
+    U64 pinned = slider_blockers(pos, king_square, side ^ 1) & own;
+
+    // pawns
+    bitboard = pos->bitboards[pawn];
+    while (bitboard)
+    {
+        // init source square
+        source_square = get_ls1b_index(bitboard);
+        int promotes = (promotion_rank >> source_square) & 1;
+
+        // squares this pawn may land on
+        U64 allowed = check_mask;
+        if (get_bit(pinned, source_square))
+            allowed &= line_through[king_square][source_square];
+
+        // quiet pawn moves
+        target_square = source_square + push;
+        if (!get_bit(occupancy, target_square))
         {
-            // pick up white pawn bitboards index
-            if (piece == P)
+            if (get_bit(allowed, target_square))
             {
-                // loop over white pawns within white pawn bitboard
-                while (bitboard)
+                // pawn promotion
+                if (promotes)
                 {
-                    // init source square
-                    source_square = get_ls1b_index(bitboard);
-                    
-                    // init target square
-                    target_square = source_square - 8;
-                    
-                    // generate quiet pawn moves
-                    if (!(target_square < a8) && !get_bit(occupancies[both], target_square))
-                    {
-                        // pawn promotion
-                        if (source_square >= a7 && source_square <= h7)
-                        {                            
-                            add_move(move_list, encode_move(source_square, target_square, piece, Q, 0, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, R, 0, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, B, 0, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, N, 0, 0, 0, 0));
-                        }
-                        
-                        else
-                        {
-                            // one square ahead pawn move
-                            add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
-                            
-                            // two squares ahead pawn move
-                            if ((source_square >= a2 && source_square <= h2) && !get_bit(occupancies[both], target_square - 8))
-                                add_move(move_list, encode_move(source_square, target_square - 8, piece, 0, 0, 1, 0, 0));
-                        }
-                    }
-                    
-                    // init pawn attacks bitboard
-                    attacks = pawn_attacks[side][source_square] & occupancies[black];
-                    
-                    // generate pawn captures
-                    while (attacks)
+                    add_move(move_list, encode_move(source_square, target_square, pawn, queen, 0, 0, 0, 0));
+
+                    if (!captures_only)
                     {
-                        // init target square
-                        target_square = get_ls1b_index(attacks);
-                        
-                        // pawn promotion
-                        if (source_square >= a7 && source_square <= h7)
-                        {
-                            add_move(move_list, encode_move(source_square, target_square, piece, Q, 1, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, R, 1, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, B, 1, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, N, 1, 0, 0, 0));
-                        }
-                        
-                        else
-                            // one square ahead pawn move
-                            add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
-                        
-                        // pop ls1b of the pawn attacks
-                        pop_bit(attacks, target_square);
-                    }
-                    
-                    // generate enpassant captures
-                    if (enpassant != no_sq)
-                    {
-                        // lookup pawn attacks and bitwise AND with enpassant square (bit)
-                        U64 enpassant_attacks = pawn_attacks[side][source_square] & (1ULL << enpassant);
-                        
-                        // make sure enpassant capture available
-                        if (enpassant_attacks)
-                        {
-                            // init enpassant capture target square
-                            int target_enpassant = get_ls1b_index(enpassant_attacks);
-                            add_move(move_list, encode_move(source_square, target_enpassant, piece, 0, 1, 0, 1, 0));
-                        }
-                    }
-                    
-                    // pop ls1b from piece bitboard copy
-                    pop_bit(bitboard, source_square);
-                }
-            }
-            
-            // castling moves
-            if (piece == K)
-            {
-                // king side castling is available
-                if (castle & wk)
-                {
-                    // make sure square between king and king's rook are empty
-                    if (!get_bit(occupancies[both], f1) && !get_bit(occupancies[both], g1))
-                    {
-                        // make sure king and the f1 squares are not under attacks
-                        if (!is_square_attacked(e1, black) && !is_square_attacked(f1, black))
-                            add_move(move_list, encode_move(e1, g1, piece, 0, 0, 0, 0, 1));
-                    }
-                }
-                
-                // queen side castling is available
-                if (castle & wq)
-                {
-                    // make sure square between king and queen's rook are empty
-                    if (!get_bit(occupancies[both], d1) && !get_bit(occupancies[both], c1) && !get_bit(occupancies[both], b1))
-                    {
-                        // make sure king and the d1 squares are not under attacks
-                        if (!is_square_attacked(e1, black) && !is_square_attacked(d1, black))
-                            add_move(move_list, encode_move(e1, c1, piece, 0, 0, 0, 0, 1));
+                        add_move(move_list, encode_move(source_square, target_square, pawn, (queen - 1), 0, 0, 0, 0));
+                        add_move(move_list, encode_move(source_square, target_square, pawn, (queen - 2), 0, 0, 0, 0));
+                        add_move(move_list, encode_move(source_square, target_square, pawn, (queen - 3), 0, 0, 0, 0));
                     }
                 }
+
+                // one square ahead pawn move
+                else if (!captures_only)
+                    add_move(move_list, encode_move(source_square, target_square, pawn, 0, 0, 0, 0, 0));
             }
+
+            // two squares ahead pawn move
+            if (!captures_only && get_bit(start_rank, source_square) &&
+                !get_bit(occupancy, target_square + push) && get_bit(allowed, target_square + push))
+                add_move(move_list, encode_move(source_square, (target_square + push), pawn, 0, 0, 1, 0, 0));
         }
-        
-        // generate black pawns & black king castling moves
-        else
+
+        // init pawn attacks bitboard
+        attacks = quiets_only ? 0ULL : pawn_attacks[side][source_square] & enemy & allowed;
+
+        // generate pawn captures
+        while (attacks)
         {
-            // pick up black pawn bitboards index
-            if (piece == p)
-            {
-                // loop over white pawns within white pawn bitboard
-                while (bitboard)
-                {
-                    // init source square
-                    source_square = get_ls1b_index(bitboard);
-                    
-                    // init target square
-                    target_square = source_square + 8;
-                    
-                    // generate quiet pawn moves
-                    if (!(target_square > h1) && !get_bit(occupancies[both], target_square))
-                    {
-                        // pawn promotion
-                        if (source_square >= a2 && source_square <= h2)
-                        {
-                            add_move(move_list, encode_move(source_square, target_square, piece, q, 0, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, r, 0, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, b, 0, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, n, 0, 0, 0, 0));
-                        }
-                        
-                        else
-                        {
-                            // one square ahead pawn move
-                            add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
-                            
-                            // two squares ahead pawn move
-                            if ((source_square >= a7 && source_square <= h7) && !get_bit(occupancies[both], target_square + 8))
-                                add_move(move_list, encode_move(source_square, target_square + 8, piece, 0, 0, 1, 0, 0));
-                        }
-                    }
-                    
-                    // init pawn attacks bitboard
-                    attacks = pawn_attacks[side][source_square] & occupancies[white];
-                    
-                    // generate pawn captures
-                    while (attacks)
-                    {
-                        // init target square
-                        target_square = get_ls1b_index(attacks);
-                        
-                        // pawn promotion
-                        if (source_square >= a2 && source_square <= h2)
-                        {
-                            add_move(move_list, encode_move(source_square, target_square, piece, q, 1, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, r, 1, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, b, 1, 0, 0, 0));
-                            add_move(move_list, encode_move(source_square, target_square, piece, n, 1, 0, 0, 0));
-                        }
-                        
-                        else
-                            // one square ahead pawn move
-                            add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
-                        
-                        // pop ls1b of the pawn attacks
-                        pop_bit(attacks, target_square);
-                    }
-                    
-                    // generate enpassant captures
-                    if (enpassant != no_sq)
-                    {
-                        // lookup pawn attacks and bitwise AND with enpassant square (bit)
-                        U64 enpassant_attacks = pawn_attacks[side][source_square] & (1ULL << enpassant);
-                        
-                        // make sure enpassant capture available
-                        if (enpassant_attacks)
-                        {
-                            // init enpassant capture target square
-                            int target_enpassant = get_ls1b_index(enpassant_attacks);
-                            add_move(move_list, encode_move(source_square, target_enpassant, piece, 0, 1, 0, 1, 0));
-                        }
-                    }
-                    
-                    // pop ls1b from piece bitboard copy
-                    pop_bit(bitboard, source_square);
-                }
-            }
-            
-            // castling moves
-            if (piece == k)
+            // init target square
+            target_square = get_ls1b_index(attacks);
+
+            // pawn promotion
+            if (promotes)
             {
-                // king side castling is available
-                if (castle & bk)
-                {
-                    // make sure square between king and king's rook are empty
-                    if (!get_bit(occupancies[both], f8) && !get_bit(occupancies[both], g8))
-                    {
-                        // make sure king and the f8 squares are not under attacks
-                        if (!is_square_attacked(e8, white) && !is_square_attacked(f8, white))
-                            add_move(move_list, encode_move(e8, g8, piece, 0, 0, 0, 0, 1));
-                    }
-                }
-                
-                // queen side castling is available
-                if (castle & bq)
-                {
-                    // make sure square between king and queen's rook are empty
-                    if (!get_bit(occupancies[both], d8) && !get_bit(occupancies[both], c8) && !get_bit(occupancies[both], b8))
-                    {
-                        // make sure king and the d8 squares are not under attacks
-                        if (!is_square_attacked(e8, white) && !is_square_attacked(d8, white))
-                            add_move(move_list, encode_move(e8, c8, piece, 0, 0, 0, 0, 1));
-                    }
-                }
+                add_move(move_list, encode_move(source_square, target_square, pawn, queen, 1, 0, 0, 0));
+                add_move(move_list, encode_move(source_square, target_square, pawn, (queen - 1), 1, 0, 0, 0));
+                add_move(move_list, encode_move(source_square, target_square, pawn, (queen - 2), 1, 0, 0, 0));
+                add_move(move_list, encode_move(source_square, target_square, pawn, (queen - 3), 1, 0, 0, 0));
             }
+
+            else
+                add_move(move_list, encode_move(source_square, target_square, pawn, 0, 1, 0, 0, 0));
+
+            // pop ls1b of the pawn attacks
+            pop_bit(attacks, target_square);
         }
-        
-        // genarate knight moves
-        if ((side == white) ? piece == N : piece == n)
+
+        // generate enpassant captures: replay the capture on the occupancy and
+        // make sure no enemy piece other than the captured pawn hits the king
+        if (!quiets_only && pos->enpassant != no_sq && (pawn_attacks[side][source_square] & (1ULL << pos->enpassant)))
         {
-            // loop over source squares of piece bitboard copy
-            while (bitboard)
-            {
-                // init source square
-                source_square = get_ls1b_index(bitboard);
-                
-                // init piece attacks in order to get set of target squares
-                attacks = knight_attacks[source_square] & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
-                
-                // loop over target squares available from generated attacks
-                while (attacks)
-                {
-                    // init target square
-                    target_square = get_ls1b_index(attacks);    
-                    
-                    // quiet move
-                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
-                    
-                    else
-                        // capture move
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
-                    
-                    // pop ls1b in current attacks set
-                    pop_bit(attacks, target_square);
-                }
-                
-                
-                // pop ls1b of the current piece bitboard copy
-                pop_bit(bitboard, source_square);
-            }
+            int victim_square = pos->enpassant - push;
+            U64 occupancy_after = (occupancy ^ (1ULL << source_square) ^ (1ULL << victim_square)) | (1ULL << pos->enpassant);
+
+            if (!(attackers_of_side(pos, king_square, side ^ 1, occupancy_after) & ~(1ULL << victim_square)))
+                add_move(move_list, encode_move(source_square, pos->enpassant, pawn, 0, 1, 0, 1, 0));
         }
-        
-        // generate bishop moves
-        if ((side == white) ? piece == B : piece == b)
+
+        // pop ls1b from piece bitboard copy
+        pop_bit(bitboard, source_square);
+    }
+
+    // knights, bishops, rooks and queens
+    U64 move_mask = targets & check_mask;
+    for (int piece = N + offset; piece <= Q + offset; piece++)
+    {
+        // init piece bitboard copy (a pinned knight can never move)
+        bitboard = pos->bitboards[piece];
+        if (piece == N + offset)
+            bitboard &= ~pinned;
+
+        // loop over source squares of piece bitboard copy
+        while (bitboard)
         {
-            // loop over source squares of piece bitboard copy
-            while (bitboard)
+            // init source square
+            source_square = get_ls1b_index(bitboard);
+
+            // init piece attacks in order to get set of target squares
+            switch (piece - offset)
             {
-                // init source square
-                source_square = get_ls1b_index(bitboard);
-                
-                // init piece attacks in order to get set of target squares
-                attacks = get_bishop_attacks(source_square, occupancies[both]) & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
-                
-                // loop over target squares available from generated attacks
-                while (attacks)
-                {
-                    // init target square
-                    target_square = get_ls1b_index(attacks);    
-                    
-                    // quiet move
-                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
-                    
-                    else
-                        // capture move
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
-                    
-                    // pop ls1b in current attacks set
-                    pop_bit(attacks, target_square);
-                }
-                
-                
-                // pop ls1b of the current piece bitboard copy
-                pop_bit(bitboard, source_square);
+                case N: attacks = knight_attacks[source_square]; break;
+                case B: attacks = get_bishop_attacks(source_square, occupancy); break;
+                case R: attacks = get_rook_attacks(source_square, occupancy); break;
+                default: attacks = get_queen_attacks(source_square, occupancy); break;
             }
-        }
-        
-        // generate rook moves
-        if ((side == white) ? piece == R : piece == r)
-        {
-            // loop over source squares of piece bitboard copy
-            while (bitboard)
+            attacks &= move_mask;
+
+            // a pinned slider may only slide along its pin
+            if (get_bit(pinned, source_square))
+                attacks &= line_through[king_square][source_square];
+
+            // loop over target squares available from generated attacks
+            while (attacks)
             {
-                // init source square
-                source_square = get_ls1b_index(bitboard);
-                
-                // init piece attacks in order to get set of target squares
-                attacks = get_rook_attacks(source_square, occupancies[both]) & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
-                
-                // loop over target squares available from generated attacks
-                while (attacks)
-                {
-                    // init target square
-                    target_square = get_ls1b_index(attacks);    
-                    
-                    // quiet move
-                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
-                    
-                    else
-                        // capture move
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
-                    
-                    // pop ls1b in current attacks set
-                    pop_bit(attacks, target_square);
-                }
-                
-                
-                // pop ls1b of the current piece bitboard copy
-                pop_bit(bitboard, source_square);
+                // init target square
+                target_square = get_ls1b_index(attacks);
+
+                add_piece_move(move_list, source_square, target_square, piece, enemy);
+
+                // pop ls1b in current attacks set
+                pop_bit(attacks, target_square);
             }
+
+            // pop ls1b of the current piece bitboard copy
+            pop_bit(bitboard, source_square);
         }
-        
-        // generate queen moves
-        if ((side == white) ? piece == Q : piece == q)
+    }
+
+    // castling: never out of check, and the king may not pass through or land on an attacked square
+    if (captures_only || checkers)
+        return;
+
+    if (side == white)
+    {
+        // king side castling is available
+        if ((pos->castle & wk) && !get_bit(occupancy, f1) && !get_bit(occupancy, g1) &&
+            !is_square_attacked(pos, f1, black) && !is_square_attacked(pos, g1, black))
+            add_move(move_list, encode_move(e1, g1, K, 0, 0, 0, 0, 1));
+
+        // queen side castling is available
+        if ((pos->castle & wq) && !get_bit(occupancy, d1) && !get_bit(occupancy, c1) && !get_bit(occupancy, b1) &&
+            !is_square_attacked(pos, d1, black) && !is_square_attacked(pos, c1, black))
+            add_move(move_list, encode_move(e1, c1, K, 0, 0, 0, 0, 1));
+    }
+
+    else
+    {
+        // king side castling is available
+        if ((pos->castle & bk) && !get_bit(occupancy, f8) && !get_bit(occupancy, g8) &&
+            !is_square_attacked(pos, f8, white) && !is_square_attacked(pos, g8, white))
+            add_move(move_list, encode_move(e8, g8, k, 0, 0, 0, 0, 1));
+
+        // queen side castling is available
+        if ((pos->castle & bq) && !get_bit(occupancy, d8) && !get_bit(occupancy, c8) && !get_bit(occupancy, b8) &&
+            !is_square_attacked(pos, d8, white) && !is_square_attacked(pos, c8, white))
+            add_move(move_list, encode_move(e8, c8, k, 0, 0, 0, 0, 1));
+    }
+}
+
+// generate all legal moves
+static inline void generate_moves(position *pos, moves *move_list)
+{
+    generate_legal(pos, move_list, gen_all);
+}
+
+// v2.4: generate legal captures (incl. en passant and capture promotions) plus
+// quiet queen promotions, for quiescence, probcut and the capture stage of the
+// move picker
+static inline void generate_captures(position *pos, moves *move_list)
+{
+    generate_legal(pos, move_list, gen_captures);
+}
+
+// v2.4: generate legal non-captures (pushes, all four quiet promotions and
+// castling), for the quiet stage of the move picker
+static inline void generate_quiets(position *pos, moves *move_list)
+{
+    generate_legal(pos, move_list, gen_quiets);
+}
+
+// v2.4: generate legal quiet moves that give check, for the first ply of
+// quiescence. Direct checks land on the squares each piece type would attack
+// the enemy king from (pawn/knight rings around the king, slider rays seen
+// through the current occupancy); discovered checks move one of our own pieces
+// off the line between the enemy king and one of our sliders. Promotions are
+// left to generate_captures() and castling is skipped. Must not be called
+// while the side to move is in check.
+static inline void generate_quiet_checks(position *pos, moves *move_list)
+{
+    // init move count
+    move_list->count = 0;
+
+    // define source & target squares
+    int source_square, target_square;
+
+    // define current piece's bitboard copy & it's attacks
+    U64 bitboard, attacks;
+
+    // side-relative pieces and squares
+    int side = pos->side;
+    int offset = side * 6;
+    int pawn = P + offset;
+    int push = (side == white) ? -8 : 8;
+    U64 promotion_rank = (side == white) ? 0x000000000000FF00ULL : 0x00FF000000000000ULL;
+    U64 start_rank = (side == white) ? 0x00FF000000000000ULL : 0x000000000000FF00ULL;
+    U64 own = pos->occupancies[side];
+    U64 empty = ~pos->occupancies[both];
+
+    int king_square = get_ls1b_index(pos->bitboards[K + offset]);
+    int enemy_king_square = get_ls1b_index(pos->bitboards[K + (offset ^ 6)]);
+
+    // our pinned pieces, and our pieces whose departure uncovers a check
+    U64 pinned = slider_blockers(pos, king_square, side ^ 1) & own;
+    U64 discoverers = slider_blockers(pos, enemy_king_square, side) & own;
+
+    // squares from which each piece type gives direct check
+    U64 check_squares[6];
+    check_squares[P] = pawn_attacks[side ^ 1][enemy_king_square];
+    check_squares[N] = knight_attacks[enemy_king_square];
+    check_squares[B] = get_bishop_attacks(enemy_king_square, pos->occupancies[both]);
+    check_squares[R] = get_rook_attacks(enemy_king_square, pos->occupancies[both]);
+    check_squares[Q] = check_squares[B] | check_squares[R];
+    check_squares[K] = 0ULL;
+
+    // pawn pushes (promotions excluded)
+    bitboard = pos->bitboards[pawn] & ~promotion_rank;
+    while (bitboard)
+    {
+        // init source square
+        source_square = get_ls1b_index(bitboard);
+
+        // squares this pawn may land on and still give check
+        U64 allowed = empty & check_squares[P];
+        if (get_bit(discoverers, source_square))
+            allowed = empty & (check_squares[P] | ~line_through[enemy_king_square][source_square]);
+        if (get_bit(pinned, source_square))
+            allowed &= line_through[king_square][source_square];
+
+        target_square = source_square + push;
+        if (get_bit(empty, target_square))
         {
-            // loop over source squares of piece bitboard copy
-            while (bitboard)
-            {
-                // init source square
-                source_square = get_ls1b_index(bitboard);
-                
-                // init piece attacks in order to get set of target squares
-                attacks = get_queen_attacks(source_square, occupancies[both]) & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
-                
-                // loop over target squares available from generated attacks
-                while (attacks)
-                {
-                    // init target square
-                    target_square = get_ls1b_index(attacks);    
-                    
-                    // quiet move
-                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
-                    
-                    else
-                        // capture move
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
-                    
-                    // pop ls1b in current attacks set
-                    pop_bit(attacks, target_square);
-                }
-                
-                
-                // pop ls1b of the current piece bitboard copy
-                pop_bit(bitboard, source_square);
-            }
+            // one square ahead pawn move
+            if (get_bit(allowed, target_square))
+                add_move(move_list, encode_move(source_square, target_square, pawn, 0, 0, 0, 0, 0));
+
+            // two squares ahead pawn move
+            if (get_bit(start_rank, source_square) && get_bit(allowed, target_square + push))
+                add_move(move_list, encode_move(source_square, (target_square + push), pawn, 0, 0, 1, 0, 0));
         }
 
-        // generate king moves
-        if ((side == white) ? piece == K : piece == k)
+        // pop ls1b from piece bitboard copy
+        pop_bit(bitboard, source_square);
+    }
+
+    // knights, bishops, rooks and queens
+    for (int piece = N + offset; piece <= Q + offset; piece++)
+    {
+        // init piece bitboard copy (a pinned knight can never move)
+        bitboard = pos->bitboards[piece];
+        if (piece == N + offset)
+            bitboard &= ~pinned;
+
+        // loop over source squares of piece bitboard copy
+        while (bitboard)
         {
-            // loop over source squares of piece bitboard copy
-            while (bitboard)
+            // init source square
+            source_square = get_ls1b_index(bitboard);
+
+            // init piece attacks in order to get set of target squares
+            switch (piece - offset)
             {
-                // init source square
-                source_square = get_ls1b_index(bitboard);
-                
-                // init piece attacks in order to get set of target squares
-                attacks = king_attacks[source_square] & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
-                
-                // loop over target squares available from generated attacks
-                while (attacks)
-                {
-                    // init target square
-                    target_square = get_ls1b_index(attacks);    
-                    
-                    // quiet move
-                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
-                    
-                    else
-                        // capture move
-                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
-                    
-                    // pop ls1b in current attacks set
-                    pop_bit(attacks, target_square);
-                }
+                case N: attacks = knight_attacks[source_square]; break;
+                case B: attacks = get_bishop_attacks(source_square, pos->occupancies[both]); break;
+                case R: attacks = get_rook_attacks(source_square, pos->occupancies[both]); break;
+                default: attacks = get_queen_attacks(source_square, pos->occupancies[both]); break;
+            }
 
-                // pop ls1b of the current piece bitboard copy
-                pop_bit(bitboard, source_square);
+            // direct checks, or any square off the line for a discovering piece
+            if (get_bit(discoverers, source_square))
+                attacks &= empty & (check_squares[piece - offset] | ~line_through[enemy_king_square][source_square]);
+            else
+                attacks &= empty & check_squares[piece - offset];
+
+            // a pinned slider may only slide along its pin
+            if (get_bit(pinned, source_square))
+                attacks &= line_through[king_square][source_square];
+
+            // loop over target squares available from generated attacks
+            while (attacks)
+            {
+                // init target square
+                target_square = get_ls1b_index(attacks);
+
+                add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
+
+                // pop ls1b in current attacks set
+                pop_bit(attacks, target_square);
             }
+
+            // pop ls1b of the current piece bitboard copy
+            pop_bit(bitboard, source_square);
+        }
+    }
+
+    // king: discovered checks only, to squares the enemy does not attack
+    if (get_bit(discoverers, king_square))
+    {
+        U64 occupancy_without_king = pos->occupancies[both] ^ (1ULL << king_square);
+        attacks = king_attacks[king_square] & empty & ~line_through[enemy_king_square][king_square];
+
+        while (attacks)
+        {
+            target_square = get_ls1b_index(attacks);
+
+            if (!attackers_of_side(pos, target_square, side ^ 1, occupancy_without_king))
+                add_move(move_list, encode_move(king_square, target_square, (K + offset), 0, 0, 0, 0, 0));
+
+            pop_bit(attacks, target_square);
         }
     }
 }
@@ -2542,8 +2662,41 @@ static inline void generate_moves(moves *move_list)
 __thread U64 nodes;
 __thread U64 tb_hits;
 
+// v2.4: Cache statistics. Plain per-thread counters so the hot path pays one
+// increment; helper threads hand theirs to the main thread when they finish.
+typedef struct {
+    U64 tt_probes;      // TT lookups (read_hash_entry / read_hash_eval)
+    U64 tt_hits;        // lookups whose 32-bit key verified
+    U64 tt_collisions;  // verified hits whose move did not fit the position
+    U64 eval_probes;    // static evals needed by the search
+    U64 eval_hits;      // ... served from the TT instead of evaluate()
+    U64 pawn_probes;    // pawn_table lookups
+    U64 pawn_hits;
+} cache_stats;
+
+__thread cache_stats search_stats;
+
+// v2.4: Published node / tbhit counts, one cache line per search thread so the
+// periodic stores never share a line. Slot 0 belongs to the thread running
+// search_position(), slots 1.. to the pool helpers; threads refresh their slot
+// every PUBLISH_INTERVAL nodes and the main thread sums the slots for its info lines.
+typedef struct {
+    U64 nodes;
+    U64 tb_hits;
+} __attribute__((aligned(64))) thread_counters;
+
+static thread_counters counter_slots[THREADS_LIMIT];
+__thread thread_counters *my_counters = NULL;  // this thread's slot while searching
+
+static inline void publish_counters()
+{
+    if (!my_counters) return;
+    __atomic_store_n(&my_counters->nodes, nodes, __ATOMIC_RELAXED);
+    __atomic_store_n(&my_counters->tb_hits, tb_hits, __ATOMIC_RELAXED);
+}
+
 // perft driver
-static inline void perft_driver(int depth)
+static inline void perft_driver(position *pos, int depth)
 {
     // reccursion escape condition
     if (depth == 0)
@@ -2557,29 +2710,31 @@ static inline void perft_driver(int depth)
     moves move_list[1];
     
     // generate moves
-    generate_moves(move_list);
+    generate_moves(pos, move_list);
+    
+    // v2.4: bulk counting - the generator is legal, so the last ply is just the move count
+    if (depth == 1)
+    {
+        nodes += move_list->count;
+        return;
+    }
     
-        // loop over generated moves
+    // loop over generated moves
     for (int move_count = 0; move_count < move_list->count; move_count++)
     {   
-        // preserve board state
-        copy_board();
-        
         // make move
-        if (!make_move(move_list->moves[move_count], all_moves))
-            // skip to the next move
-            continue;
+        make_move(pos, move_list->moves[move_count], legal_moves);
         
         // call perft driver recursively
-        perft_driver(depth - 1);
+        perft_driver(pos, depth - 1);
         
         // take back
-        take_back();        
+        unmake_move(pos);
     }
 }
 
 // perft test
-void perft_test(int depth)
+void perft_test(position *pos, int depth)
 {
     printf("\n     Performance test\n\n");
     
@@ -2587,7 +2742,7 @@ void perft_test(int depth)
     moves move_list[1];
     
     // generate moves
-    generate_moves(move_list);
+    generate_moves(pos, move_list);
     
     // init start time
     long start = get_time_ms();
@@ -2595,25 +2750,20 @@ void perft_test(int depth)
     // loop over generated moves
     for (int move_count = 0; move_count < move_list->count; move_count++)
     {   
-        // preserve board state
-        copy_board();
-        
         // make move
-        if (!make_move(move_list->moves[move_count], all_moves))
-            // skip to the next move
-            continue;
+        make_move(pos, move_list->moves[move_count], legal_moves);
         
         // cummulative nodes
         long cummulative_nodes = nodes;
         
         // call perft driver recursively
-        perft_driver(depth - 1);
+        perft_driver(pos, depth - 1);
         
         // old nodes
         long old_nodes = nodes - cummulative_nodes;
         
         // take back
-        take_back();
+        unmake_move(pos);
         
         // print move
         printf("     move: %s%s%c  nodes: %ld\n", square_to_coordinates[get_move_source(move_list->moves[move_count])],
@@ -3046,6 +3196,39 @@ int tp[TP_COUNT] = {
      30,   // [786] TP_BACKWARD_OPEN: backward pawn on open/semi-open file
 };
 
+// v2.4: Fill piece_material / piece_square_* from tp[]. Run at startup, and by
+// the tuner whenever tp[] changes.
+void init_piece_square_tables()
+{
+    const int material[6] = { TP_MAT_PAWN, TP_MAT_KNIGHT, TP_MAT_BISHOP, TP_MAT_ROOK, TP_MAT_QUEEN, 0 };
+
+    for (int piece = P; piece <= K; piece++)
+    {
+        piece_material[piece] = material[piece];
+        piece_material[piece + 6] = -material[piece];
+
+        for (int square = 0; square < 64; square++)
+        {
+            int mg = 0, eg = 0;
+            switch (piece)
+            {
+                case P: mg = TP_PST_PAWN_MG(square);   eg = TP_PST_PAWN_EG(square);   break;
+                case N: mg = TP_PST_KNIGHT(square);    eg = TP_PST_KNIGHT(square);    break;
+                case B: mg = TP_PST_BISHOP_MG(square); eg = TP_PST_BISHOP_EG(square); break;
+                case R: mg = TP_PST_ROOK_MG(square);   eg = TP_PST_ROOK_EG(square);   break;
+                case Q: mg = TP_PST_QUEEN_MG(square);  eg = TP_PST_QUEEN_EG(square);  break;
+                case K: mg = TP_PST_KING_MG(square);   eg = TP_PST_KING_EG(square);   break;
+            }
+
+            // white reads the table directly, black through the mirrored square
+            piece_square_mg[piece][square] = mg;
+            piece_square_eg[piece][square] = eg;
+            piece_square_mg[piece + 6][mirror_score[square]] = -mg;
+            piece_square_eg[piece + 6][mirror_score[square]] = -eg;
+        }
+    }
+}
+
 // Inner squares mask: c3-f6 (central 16 squares, weighted more in mobility)
 #define INNER_SQUARES 0x00003C3C3C3C0000ULL
 
@@ -3062,38 +3245,25 @@ const int isqrt_x20[32] = {
 // For black advancement: rank = get_rank[sq]
 
 // Calculate game phase (0-24)
-static inline int get_game_phase()
+static inline int get_game_phase(position *pos)
 {
-    int phase = 0;
-    // Knights: weight 1
-    phase += count_bits(bitboards[N]) + count_bits(bitboards[n]);
-    // Bishops: weight 1
-    phase += count_bits(bitboards[B]) + count_bits(bitboards[b]);
-    // Rooks: weight 2
-    phase += 2 * (count_bits(bitboards[R]) + count_bits(bitboards[r]));
-    // Queens: weight 4
-    phase += 4 * (count_bits(bitboards[Q]) + count_bits(bitboards[q]));
-    if (phase > TOTAL_PHASE) phase = TOTAL_PHASE;
-    return phase;
+    // v2.4: kept up to date by make_move()
+    return (pos->phase > TOTAL_PHASE) ? TOTAL_PHASE : pos->phase;
 }
 
 // Fast material-only evaluation for lazy pruning in quiescence
-static inline int evaluate_lazy()
+static inline int evaluate_lazy(position *pos)
 {
-    int score = 0;
-    score += TP_MAT_PAWN   * (count_bits(bitboards[P]) - count_bits(bitboards[p]));
-    score += TP_MAT_KNIGHT * (count_bits(bitboards[N]) - count_bits(bitboards[n]));
-    score += TP_MAT_BISHOP * (count_bits(bitboards[B]) - count_bits(bitboards[b]));
-    score += TP_MAT_ROOK   * (count_bits(bitboards[R]) - count_bits(bitboards[r]));
-    score += TP_MAT_QUEEN  * (count_bits(bitboards[Q]) - count_bits(bitboards[q]));
-    return (side == white) ? score : -score;
+    return (pos->side == white) ? pos->material : -pos->material;
 }
 
-// Pawn hash table — caches pawn structure eval (passed, doubled, isolated, islands)
+// Pawn hash table — caches pawn structure eval (passed, doubled, isolated, islands).
+// v2.4: Indexed by the Zobrist pawn key. Scores are stored as separate MG/EG parts
+// and tapered on lookup, so one entry serves every game phase.
 typedef struct {
     U64 key;
-    int white_score;
-    int black_score;
+    int white_mg, white_eg;
+    int black_mg, black_eg;
     U64 white_passed;
     U64 black_passed;
 } pawn_hash_entry;
@@ -3102,26 +3272,21 @@ typedef struct {
 #define PAWN_HASH_MASK (PAWN_HASH_SIZE - 1)
 static pawn_hash_entry pawn_table[PAWN_HASH_SIZE];
 
-// Eval transposition table (128K entries, ~1MB) — caches evaluate() results
-#define ETT_SIZE 131072
-#define ETT_MASK (ETT_SIZE - 1)
-typedef struct { U64 key; int score; } EvalEntry;
-static EvalEntry eval_tt[ETT_SIZE];  // shared (not __thread); benign SMP races
 
-
-// Compute pawn structure score for one side; sets *out_passed to passed pawn bitboard.
-// Called from evaluate() to fill the pawn hash table on a miss.
-static int pawn_eval_side(int color, int phase, U64 *out_passed)
+// Compute pawn structure score for one side as MG/EG parts; sets *out_passed to
+// passed pawn bitboard. Called from evaluate() to fill the pawn hash table on a miss.
+static void pawn_eval_side(position *pos, int color, int *out_mg, int *out_eg, U64 *out_passed)
 {
-    int score = 0;
+    int mg = 0, eg = 0;
+    int score = 0;  // terms with no MG/EG split
     int pawn_files[8] = {0};
     int pawn_file_mask = 0;
     U64 passed_bb = 0ULL;
 
     int pawn_piece = (color == white) ? P : p;
     int enemy_pawn = (color == white) ? p : P;
-    U64 own_pawns_bb   = bitboards[pawn_piece];
-    U64 enemy_pawns_bb = bitboards[enemy_pawn];
+    U64 own_pawns_bb   = pos->bitboards[pawn_piece];
+    U64 enemy_pawns_bb = pos->bitboards[enemy_pawn];
 
     U64 bb = own_pawns_bb;
     while (bb) {
@@ -3130,9 +3295,6 @@ static int pawn_eval_side(int color, int phase, U64 *out_passed)
         int file = sq & 7;
         int rank = get_rank[sq];
 
-        score += TP_MAT_PAWN;
-        score += (TP_PST_PAWN_MG(wsq) * phase + TP_PST_PAWN_EG(wsq) * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
-
         pawn_files[file]++;
         pawn_file_mask |= (1 << file);
 
@@ -3143,18 +3305,16 @@ static int pawn_eval_side(int color, int phase, U64 *out_passed)
             // Fully passed pawn — rank-indexed bonus
             int advancement = (color == white) ? (7 - rank) : rank;
             if (advancement > 7) advancement = 7;
-            int pmg = tp[756 + advancement];
-            int peg = tp[764 + advancement];
-            score += (pmg * phase + peg * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
+            mg += tp[756 + advancement];
+            eg += tp[764 + advancement];
             passed_bb |= (1ULL << sq);
         } else if (count_bits(pm_blockers) == 1) {
             // v19: Candidate passed pawn — exactly one enemy pawn blocking the passed mask
             int advancement = (color == white) ? (7 - rank) : rank;
             if (advancement > 7) advancement = 7;
             int denom = TP_CAND_DENOM > 0 ? TP_CAND_DENOM : 1;
-            int cand_mg = tp[756 + advancement] / denom;
-            int cand_eg = tp[764 + advancement] / denom;
-            score += (cand_mg * phase + cand_eg * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
+            mg += tp[756 + advancement] / denom;
+            eg += tp[764 + advancement] / denom;
         }
 
         int stop_sq = (color == white) ? sq - 8 : sq + 8;
@@ -3202,12 +3362,13 @@ static int pawn_eval_side(int color, int phase, U64 *out_passed)
         if (islands > 1) score -= (islands - 1) * TP_PAWN_ISLAND;
     }
 
+    *out_mg = mg + score;
+    *out_eg = eg + score;
     *out_passed = passed_bb;
-    return score;
 }
 
 // Evaluate one side's material + positional score
-static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own_passed_bb_in)
+static inline int evaluate_side(position *pos, int color, int phase, int pawn_score_in, U64 own_passed_bb_in)
 {
     int score = pawn_score_in;
     int end_game = (phase < PHASE_THRESHOLD);
@@ -3223,11 +3384,11 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
     int enemy_pawn   = (color == white) ? p : P;
     int enemy_color  = 1 - color;
 
-    U64 bb, occ_all = occupancies[both];
-    U64 own_pawns_bb    = bitboards[pawn_piece];
-    U64 enemy_pawns_bb  = bitboards[enemy_pawn];
+    U64 bb, occ_all = pos->occupancies[both];
+    U64 own_pawns_bb    = pos->bitboards[pawn_piece];
+    U64 enemy_pawns_bb  = pos->bitboards[enemy_pawn];
     // v19: enemy king square for tropism and passer proximity
-    int enemy_king_sq = get_ls1b_index(bitboards[(color == white) ? k : K]);
+    int enemy_king_sq = get_ls1b_index(pos->bitboards[(color == white) ? k : K]);
 
     // Aggregate all squares attacked by enemy pawns (for safe mobility)
     U64 enemy_pawn_atk = 0ULL;
@@ -3241,14 +3402,12 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
     }
 
     // === KNIGHTS ===
-    bb = bitboards[knight_piece];
+    bb = pos->bitboards[knight_piece];
     while (bb) {
         int sq = get_ls1b_index(bb);
         int wsq = (color == white) ? sq : mirror_score[sq];
-        score += TP_MAT_KNIGHT;
-        score += TP_PST_KNIGHT(wsq);
         // Safe mobility — inner/outer split (central squares weighted more)
-        U64 mob_bb = knight_attacks[sq] & ~occupancies[color] & ~enemy_pawn_atk;
+        U64 mob_bb = knight_attacks[sq] & ~pos->occupancies[color] & ~enemy_pawn_atk;
         score += count_bits(mob_bb & INNER_SQUARES) * tp[772]
                + count_bits(mob_bb & ~INNER_SQUARES) * tp[773];
 
@@ -3275,16 +3434,13 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
     }
 
     // === BISHOPS ===
-    bb = bitboards[bishop_piece];
+    bb = pos->bitboards[bishop_piece];
     while (bb) {
         int sq = get_ls1b_index(bb);
         int wsq = (color == white) ? sq : mirror_score[sq];
-        score += TP_MAT_BISHOP;
-        // Tapered bishop PST
-        score += (TP_PST_BISHOP_MG(wsq) * phase + TP_PST_BISHOP_EG(wsq) * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
         bishop_count++;
         // Safe mobility — inner/outer split (central squares weighted more)
-        U64 mob_bb = get_bishop_attacks(sq, occ_all) & ~occupancies[color] & ~enemy_pawn_atk;
+        U64 mob_bb = get_bishop_attacks(sq, occ_all) & ~pos->occupancies[color] & ~enemy_pawn_atk;
         score += count_bits(mob_bb & INNER_SQUARES) * tp[774]
                + count_bits(mob_bb & ~INNER_SQUARES) * tp[775];
         // v19: King tropism — bishop
@@ -3312,18 +3468,15 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
     }
 
     // === ROOKS ===
-    U64 rooks_full_bb = bitboards[rook_piece];  // v16: save for connected rooks check
+    U64 rooks_full_bb = pos->bitboards[rook_piece];  // v16: save for connected rooks check
     bb = rooks_full_bb;
     while (bb) {
         int sq = get_ls1b_index(bb);
         int wsq = (color == white) ? sq : mirror_score[sq];
         int file = sq & 7;
         int rook_rank = get_rank[sq];
-        score += TP_MAT_ROOK;
-        // Tapered rook PST
-        score += (TP_PST_ROOK_MG(wsq) * phase + TP_PST_ROOK_EG(wsq) * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
         // Safe mobility — inner/outer split (central squares weighted more)
-        U64 mob_bb = get_rook_attacks(sq, occ_all) & ~occupancies[color] & ~enemy_pawn_atk;
+        U64 mob_bb = get_rook_attacks(sq, occ_all) & ~pos->occupancies[color] & ~enemy_pawn_atk;
         score += count_bits(mob_bb & INNER_SQUARES) * tp[776]
                + count_bits(mob_bb & ~INNER_SQUARES) * tp[777];
         // v19: King tropism — rook
@@ -3397,15 +3550,12 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
     }
 
     // === QUEENS ===
-    bb = bitboards[queen_piece];
+    bb = pos->bitboards[queen_piece];
     while (bb) {
         int sq = get_ls1b_index(bb);
         int wsq = (color == white) ? sq : mirror_score[sq];
-        score += TP_MAT_QUEEN;
-        // Tapered queen PST
-        score += (TP_PST_QUEEN_MG(wsq) * phase + TP_PST_QUEEN_EG(wsq) * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
         // Safe mobility — inner/outer split (central squares weighted more)
-        U64 mob_bb = get_queen_attacks(sq, occ_all) & ~occupancies[color] & ~enemy_pawn_atk;
+        U64 mob_bb = get_queen_attacks(sq, occ_all) & ~pos->occupancies[color] & ~enemy_pawn_atk;
         score += count_bits(mob_bb & INNER_SQUARES) * tp[778]
                + count_bits(mob_bb & ~INNER_SQUARES) * tp[779];
         // v19: King tropism — queen
@@ -3421,13 +3571,10 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
 
     // === KING ===
     {
-        int sq = get_ls1b_index(bitboards[king_piece]);
+        int sq = get_ls1b_index(pos->bitboards[king_piece]);
         int wsq = (color == white) ? sq : mirror_score[sq];
         int king_file = sq & 7;
 
-        // Tapered king PST
-        score += (TP_PST_KING_MG(wsq) * phase + TP_PST_KING_EG(wsq) * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
-
         // King safety (middlegame only)
         if (!end_game) {
             // v2.4: Rank-indexed pawn shield
@@ -3487,35 +3634,35 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
                 int enemy_queen  = (color == white) ? q : Q;
 
                 // Enemy pawns (weight 1)
-                U64 ep_bb = bitboards[enemy_pawn];
+                U64 ep_bb = pos->bitboards[enemy_pawn];
                 while (ep_bb) {
                     int esq = get_ls1b_index(ep_bb);
                     if (pawn_attacks[enemy_color][esq] & king_zone) king_danger += 1;
                     pop_bit(ep_bb, esq);
                 }
                 // Enemy knights (weight 2)
-                U64 en_bb = bitboards[enemy_knight];
+                U64 en_bb = pos->bitboards[enemy_knight];
                 while (en_bb) {
                     int esq = get_ls1b_index(en_bb);
                     if (knight_attacks[esq] & king_zone) king_danger += 2;
                     pop_bit(en_bb, esq);
                 }
                 // Enemy bishops (weight 2)
-                U64 eb_bb = bitboards[enemy_bishop];
+                U64 eb_bb = pos->bitboards[enemy_bishop];
                 while (eb_bb) {
                     int esq = get_ls1b_index(eb_bb);
                     if (get_bishop_attacks(esq, occ_all) & king_zone) king_danger += 2;
                     pop_bit(eb_bb, esq);
                 }
                 // Enemy rooks (weight 3)
-                U64 er_bb = bitboards[enemy_rook];
+                U64 er_bb = pos->bitboards[enemy_rook];
                 while (er_bb) {
                     int esq = get_ls1b_index(er_bb);
                     if (get_rook_attacks(esq, occ_all) & king_zone) king_danger += 3;
                     pop_bit(er_bb, esq);
                 }
                 // Enemy queen (weight 5)
-                U64 eq_bb = bitboards[enemy_queen];
+                U64 eq_bb = pos->bitboards[enemy_queen];
                 while (eq_bb) {
                     int esq = get_ls1b_index(eq_bb);
                     U64 q_attacks = get_bishop_attacks(esq, occ_all) | get_rook_attacks(esq, occ_all);
@@ -3586,7 +3733,7 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
             }
 
             // v16: King mobility bonus in endgame — king is an active piece
-            U64 king_safe_moves = king_attacks[sq] & ~occupancies[color];
+            U64 king_safe_moves = king_attacks[sq] & ~pos->occupancies[color];
             score += count_bits(king_safe_moves) * TP_KING_MOB;
         }
     }
@@ -3597,13 +3744,13 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
 
     // === Castling bonuses ===
     if (color == white) {
-        if (castle & wk) score += TP_CASTLE_RIGHT;
-        if (castle & wq) score += TP_CASTLE_RIGHT;
+        if (pos->castle & wk) score += TP_CASTLE_RIGHT;
+        if (pos->castle & wq) score += TP_CASTLE_RIGHT;
     } else {
-        if (castle & bk) score += TP_CASTLE_RIGHT;
-        if (castle & bq) score += TP_CASTLE_RIGHT;
+        if (pos->castle & bk) score += TP_CASTLE_RIGHT;
+        if (pos->castle & bq) score += TP_CASTLE_RIGHT;
     }
-    if (has_castled[color])
+    if (pos->has_castled[color])
         score += TP_CASTLED;
 
     // v19: Threat detection — bonus for own pawns attacking enemy pieces undefended by enemy pawns
@@ -3619,12 +3766,12 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
         int eb = (color == white) ? b : B;
         int er = (color == white) ? r : R;
         int eq = (color == white) ? q : Q;
-        U64 enemy_pieces = bitboards[en] | bitboards[eb] | bitboards[er] | bitboards[eq];
+        U64 enemy_pieces = pos->bitboards[en] | pos->bitboards[eb] | pos->bitboards[er] | pos->bitboards[eq];
         U64 attacked = all_pawn_attacks & enemy_pieces;
         if (attacked) {
             // Compute which are defended by enemy pawns
             U64 ep_atk = 0ULL;
-            U64 epb = bitboards[enemy_pawn];
+            U64 epb = pos->bitboards[enemy_pawn];
             while (epb) {
                 int esq = get_ls1b_index(epb);
                 ep_atk |= pawn_attacks[enemy_color][esq];
@@ -3639,17 +3786,17 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
     {
         int enemy_rook_piece  = (color == white) ? r : R;
         int enemy_queen_piece = (color == white) ? q : Q;
-        U64 heavy_targets = (bitboards[enemy_rook_piece] | bitboards[enemy_queen_piece])
+        U64 heavy_targets = (pos->bitboards[enemy_rook_piece] | pos->bitboards[enemy_queen_piece])
                             & ~enemy_pawn_atk;
         if (heavy_targets) {
-            U64 knights = bitboards[knight_piece];
+            U64 knights = pos->bitboards[knight_piece];
             while (knights) {
                 int ksq = get_ls1b_index(knights);
                 if (knight_attacks[ksq] & heavy_targets)
                     score += TP_MINOR_THREAT;
                 pop_bit(knights, ksq);
             }
-            U64 bishops = bitboards[bishop_piece];
+            U64 bishops = pos->bitboards[bishop_piece];
             while (bishops) {
                 int bsq = get_ls1b_index(bishops);
                 if (get_bishop_attacks(bsq, occ_all) & heavy_targets)
@@ -3663,73 +3810,69 @@ static inline int evaluate_side(int color, int phase, int pawn_score_in, U64 own
 }
 
 // Main evaluation function (returns score from side-to-move perspective)
-static inline int evaluate()
+static inline int evaluate(position *pos)
 {
     // v16: Insufficient material detection
-    int total_pieces = count_bits(occupancies[both]);
+    int total_pieces = count_bits(pos->occupancies[both]);
     if (total_pieces == 2) return 0;  // KK
     if (total_pieces == 3) {
-        if (count_bits(bitboards[N]) + count_bits(bitboards[n]) +
-            count_bits(bitboards[B]) + count_bits(bitboards[b]) == 1)
+        if (count_bits(pos->bitboards[N]) + count_bits(pos->bitboards[n]) +
+            count_bits(pos->bitboards[B]) + count_bits(pos->bitboards[b]) == 1)
             return 0;
     }
 
-#ifndef TUNER
-    // ETT probe — stored in white's perspective; convert to mover's on retrieval
-    {
-        EvalEntry *ee = &eval_tt[hash_key & ETT_MASK];
-        if (ee->key == hash_key) {
-            return (side == white) ? ee->score : -ee->score;
-        }
-    }
-#endif
-
-    int phase = get_game_phase();
+    int phase = get_game_phase(pos);
 
     U64 white_passed = 0ULL, black_passed = 0ULL;
-    int wpawn_score, bpawn_score;
+    int wpawn_mg, wpawn_eg, bpawn_mg, bpawn_eg;
 
 #ifdef TUNER
     // During tuning params change every eval — pawn hash would return stale scores
-    wpawn_score = pawn_eval_side(white, phase, &white_passed);
-    bpawn_score = pawn_eval_side(black, phase, &black_passed);
+    pawn_eval_side(pos, white, &wpawn_mg, &wpawn_eg, &white_passed);
+    pawn_eval_side(pos, black, &bpawn_mg, &bpawn_eg, &black_passed);
 #else
     // v18: Pawn hash — cache pawn structure eval for both sides.
-    // Phase is included in the key because pawn_eval_side() bakes tapered PST
-    // scores into the cached result; a stale entry at a different phase would
-    // return a score computed with the wrong MG/EG blend.
-    U64 pkey = bitboards[P] * 0x9e3779b97f4a7c15ULL ^
-               bitboards[p] * 0x517cc1b727220a95ULL ^
-               (U64)phase;
+    // v2.4: keyed by the incremental Zobrist pawn key alone; the cached MG/EG
+    // parts are tapered below, so the entry is valid at any phase.
+    U64 pkey = pos->pawn_key;
     int pidx = (int)(pkey & PAWN_HASH_MASK);
     pawn_hash_entry *phe = &pawn_table[pidx];
 
+    search_stats.pawn_probes++;
     if (phe->key == pkey) {
         // Cache hit
-        wpawn_score  = phe->white_score;
-        bpawn_score  = phe->black_score;
+        search_stats.pawn_hits++;
+        wpawn_mg     = phe->white_mg;
+        wpawn_eg     = phe->white_eg;
+        bpawn_mg     = phe->black_mg;
+        bpawn_eg     = phe->black_eg;
         white_passed = phe->white_passed;
         black_passed = phe->black_passed;
     } else {
         // Cache miss: compute for both sides and store
-        wpawn_score = pawn_eval_side(white, phase, &white_passed);
-        bpawn_score = pawn_eval_side(black, phase, &black_passed);
+        pawn_eval_side(pos, white, &wpawn_mg, &wpawn_eg, &white_passed);
+        pawn_eval_side(pos, black, &bpawn_mg, &bpawn_eg, &black_passed);
         phe->key          = pkey;
-        phe->white_score  = wpawn_score;
-        phe->black_score  = bpawn_score;
+        phe->white_mg     = wpawn_mg;
+        phe->white_eg     = wpawn_eg;
+        phe->black_mg     = bpawn_mg;
+        phe->black_eg     = bpawn_eg;
         phe->white_passed = white_passed;
         phe->black_passed = black_passed;
     }
 #endif
 
-    int white_score = evaluate_side(white, phase, wpawn_score, white_passed);
-    int black_score = evaluate_side(black, phase, bpawn_score, black_passed);
+    int wpawn_score = (wpawn_mg * phase + wpawn_eg * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
+    int bpawn_score = (bpawn_mg * phase + bpawn_eg * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
+
+    int white_score = evaluate_side(pos, white, phase, wpawn_score, white_passed);
+    int black_score = evaluate_side(pos, black, phase, bpawn_score, black_passed);
 
     // v19: Mop-up eval — when enemy has only their king, drive it to a corner
-    if (count_bits(occupancies[black]) == 1 && count_bits(occupancies[white]) > 1) {
+    if (count_bits(pos->occupancies[black]) == 1 && count_bits(pos->occupancies[white]) > 1) {
         // White is winning: push black king to corner and keep white king close
-        int lone_sq = get_ls1b_index(bitboards[k]);
-        int own_sq  = get_ls1b_index(bitboards[K]);
+        int lone_sq = get_ls1b_index(pos->bitboards[k]);
+        int own_sq  = get_ls1b_index(pos->bitboards[K]);
         int lr = lone_sq >> 3, lf = lone_sq & 7;
         int wr = own_sq  >> 3, wf = own_sq  & 7;
         int r_to_edge = lr > 3 ? 7 - lr : lr;
@@ -3739,10 +3882,10 @@ static inline int evaluate()
         int fdist = lf > wf ? lf - wf : wf - lf;
         int king_dist = rdist > fdist ? rdist : fdist;
         white_score += corner_bonus + (7 - king_dist) * TP_MOPUP_KDIST;
-    } else if (count_bits(occupancies[white]) == 1 && count_bits(occupancies[black]) > 1) {
+    } else if (count_bits(pos->occupancies[white]) == 1 && count_bits(pos->occupancies[black]) > 1) {
         // Black is winning: push white king to corner and keep black king close
-        int lone_sq = get_ls1b_index(bitboards[K]);
-        int own_sq  = get_ls1b_index(bitboards[k]);
+        int lone_sq = get_ls1b_index(pos->bitboards[K]);
+        int own_sq  = get_ls1b_index(pos->bitboards[k]);
         int lr = lone_sq >> 3, lf = lone_sq & 7;
         int br = own_sq  >> 3, bf = own_sq  & 7;
         int r_to_edge = lr > 3 ? 7 - lr : lr;
@@ -3754,25 +3897,27 @@ static inline int evaluate()
         black_score += corner_bonus + (7 - king_dist) * TP_MOPUP_KDIST;
     }
 
-    int score = white_score - black_score;
+    // v2.4: material and tapered PST come from the running sums in the position
+    int score = white_score - black_score + pos->material +
+                (pos->pst_mg * phase + pos->pst_eg * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
 
     // Endgame scaling — reduce score for drawish structures
     if (score != 0 && phase < PHASE_THRESHOLD) {
-        int wb = count_bits(bitboards[B]), bb2 = count_bits(bitboards[b]);
-        int wr = count_bits(bitboards[R]), br = count_bits(bitboards[r]);
-        int wq = count_bits(bitboards[Q]), bq = count_bits(bitboards[q]);
-        int wn = count_bits(bitboards[N]), bn = count_bits(bitboards[n]);
+        int wb = count_bits(pos->bitboards[B]), bb2 = count_bits(pos->bitboards[b]);
+        int wr = count_bits(pos->bitboards[R]), br = count_bits(pos->bitboards[r]);
+        int wq = count_bits(pos->bitboards[Q]), bq = count_bits(pos->bitboards[q]);
+        int wn = count_bits(pos->bitboards[N]), bn = count_bits(pos->bitboards[n]);
         int scale = 128;
 
         // Opposite-color bishops (no other major pieces)
         if (wb==1 && bb2==1 && wn==0 && bn==0 && wr==0 && br==0 && wq==0 && bq==0) {
-            int wsq = get_ls1b_index(bitboards[B]);
-            int bsq = get_ls1b_index(bitboards[b]);
+            int wsq = get_ls1b_index(pos->bitboards[B]);
+            int bsq = get_ls1b_index(pos->bitboards[b]);
             if (((wsq ^ bsq) & 1) != 0)   // opposite color squares
                 scale = TP_EG_OPP_BISH;
         }
         // Lone rook each side
-        int tot_pawns = count_bits(bitboards[P]) + count_bits(bitboards[p]);
+        int tot_pawns = count_bits(pos->bitboards[P]) + count_bits(pos->bitboards[p]);
         if (wr==1 && br==1 && wb==0 && bb2==0 && wn==0 && bn==0 && wq==0 && bq==0) {
             scale = TP_EG_ROOK_BASE + tot_pawns * TP_EG_ROOK_PAWN;
             if (scale > 128) scale = 128;
@@ -3781,16 +3926,7 @@ static inline int evaluate()
         score = score * scale / 128;
     }
 
-#ifndef TUNER
-    // ETT store — always store in white's perspective (score = white - black)
-    {
-        EvalEntry *ee = &eval_tt[hash_key & ETT_MASK];
-        ee->key   = hash_key;
-        ee->score = score;  // white's perspective always
-    }
-#endif
-
-    return (side == white) ? score : -score;
+    return (pos->side == white) ? score : -score;
 }
 
 
@@ -3807,83 +3943,343 @@ static inline int evaluate()
  ==================================
 \**********************************/
 
-// v17: Clustered TT — 4 entries per 64-byte cache line.
-// Same total memory (4M entries × 16 bytes = 64MB) but dramatically higher hit rate:
-// probing all 4 entries in a cluster costs zero extra cache misses since the whole
+// v17: Clustered TT — one 64-byte cache line per cluster.
+// Probing every entry in a cluster costs zero extra cache misses since the whole
 // cluster is fetched in one shot.
-#define TT_CLUSTER_SIZE 4
-#define TT_NUM_CLUSTERS (1 << 20)       // 1M clusters = 4M entries = 64MB
-#define TT_CLUSTER_MASK (TT_NUM_CLUSTERS - 1)
-// Keep TT_MASK alias so prefetch call compiles unchanged
-#define TT_MASK TT_CLUSTER_MASK
+// The table is heap-allocated and sized at runtime from the UCI "Hash" option
+// (MB). The cluster count is rounded down to a power of two so indexing stays a mask.
+#define TT_CLUSTER_SIZE 5
+#define TT_DEFAULT_MB 64
+#define TT_MAX_MB 65536
+#define TT_HUGE_PAGE_SIZE (2ULL * 1024 * 1024)
 
 #define NO_HASH_ENTRY 100000
 
 #define HASH_FLAG_EXACT 0
 #define HASH_FLAG_ALPHA 1  // UPPERBOUND
 #define HASH_FLAG_BETA  2  // LOWERBOUND
+#define HASH_FLAG_NONE  3  // no bound: entry only caches the static eval
 
-typedef struct {
-    unsigned int hash32;   // upper 32 bits of Zobrist key
-    int best_move;         // 4 bytes
-    int score;             // 4 bytes
-    signed char depth;     // 1 byte
-    unsigned char flag;    // 1 byte
-    unsigned char pad[2];  // 2 bytes padding
-} tt_entry;                // 16 bytes
+// Stored static eval when none was computed (node in check, TB hit)
+#define TT_EVAL_NONE (-32768)
 
+// Lockless entries (Hyatt/Mann XOR scheme). Entry i of a cluster is the pair
+// (key[i], data[i]); key holds the upper 32 Zobrist bits XOR both halves of data.
+// Lazy SMP threads read and write entries without locks; if a write from another
+// thread tears the pair, the XOR no longer reproduces the probing position's key
+// and the entry is simply treated as a miss. Keys and data are kept in separate
+// arrays so every 64-bit data word stays naturally aligned.
 typedef struct {
-    tt_entry entries[TT_CLUSTER_SIZE];  // 64 bytes = exactly one cache line
-} tt_cluster;
+    unsigned int key[TT_CLUSTER_SIZE];  // 20 bytes
+    unsigned int pad;                   //  4 bytes
+    U64 data[TT_CLUSTER_SIZE];          // 40 bytes
+} tt_cluster;                           // 64 bytes = exactly one cache line
 
-// Aligned to 64 bytes so each cluster starts on a cache line boundary
-tt_cluster hash_table[TT_NUM_CLUSTERS] __attribute__((aligned(64)));
-
-void clear_hash_table()
+/*
+    data word layout
+
+    bits  0-15  best move, compact 16-bit form (see tt_pack_move)
+    bits 16-31  static eval, int16 (TT_EVAL_NONE if not computed)
+    bits 32-48  score, 17-bit two's complement (covers +-infinity)
+    bits 49-56  depth, 8-bit two's complement
+    bits 57-58  bound flag (HASH_FLAG_*)
+    bits 59-63  search generation the entry was written in (mod 32)
+*/
+#define TT_PACK(move16, eval, score, depth, flag, gen)         \
+    (((U64)(move16) & 0xffffULL) |                             \
+     (((U64)(eval) & 0xffffULL) << 16) |                       \
+     (((U64)(score) & 0x1ffffULL) << 32) |                     \
+     (((U64)(depth) & 0xffULL) << 49) |                        \
+     (((U64)(flag) & 0x3ULL) << 57) |                          \
+     (((U64)(gen) & 0x1fULL) << 59))
+#define TT_MOVE16(data) ((int)((data) & 0xffff))
+#define TT_EVAL(data)   ((int)(short)((data) >> 16 & 0xffff))
+#define TT_SCORE(data)  ((int)((data) >> 32 & 0x1ffff) - (((data) >> 48 & 1) ? 0x20000 : 0))
+#define TT_DEPTH(data)  ((int)(signed char)((data) >> 49 & 0xff))
+#define TT_FLAG(data)   ((int)((data) >> 57 & 0x3))
+#define TT_GEN(data)    ((int)((data) >> 59 & 0x1f))
+
+// Search generation, bumped once per "go". Entries from older generations lose
+// TT_AGE_WEIGHT plies of replacement priority per generation, so deep results from
+// moves played long ago give way to the current search without clearing the table.
+#define TT_AGE_WEIGHT 8
+unsigned char tt_generation = 0;
+
+// Generations elapsed since the entry was written (mod 32)
+#define TT_AGE(data) ((tt_generation - TT_GEN(data)) & 0x1f)
+// Cluster array (at least 64-byte aligned so each cluster starts on a cache line)
+tt_cluster *hash_table = NULL;
+U64 tt_num_clusters = 0;
+U64 tt_cluster_mask = 0;
+
+// How the current table was obtained, so it is released the same way
+enum { TT_ALLOC_NONE, TT_ALLOC_MMAP, TT_ALLOC_ALIGNED };
+static int tt_alloc_kind = TT_ALLOC_NONE;
+static size_t tt_alloc_bytes = 0;
+
+// Allocate table memory, preferring huge pages so a TT probe doesn't pay a TLB miss
+// on top of the cache miss. Order: explicit hugetlb pages (only succeeds when the
+// admin has reserved them) -> 2MB-aligned heap + transparent huge page advice.
+// Returns NULL if the heap allocation fails.
+static void *tt_alloc(size_t bytes)
 {
-    memset(hash_table, 0, sizeof(hash_table));
-    memset(eval_tt, 0, sizeof(eval_tt));
+    void *mem = NULL;
+#ifdef WIN64
+    mem = _aligned_malloc(bytes, 64);
+    tt_alloc_kind = mem ? TT_ALLOC_ALIGNED : TT_ALLOC_NONE;
+#else
+#ifdef MAP_HUGETLB
+    if (bytes % TT_HUGE_PAGE_SIZE == 0) {
+        mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            tt_alloc_kind = TT_ALLOC_MMAP;
+            return mem;
+        }
+        mem = NULL;
+    }
+#endif
+    size_t align = bytes >= TT_HUGE_PAGE_SIZE ? TT_HUGE_PAGE_SIZE : 64;
+    if (posix_memalign(&mem, align, bytes) != 0) mem = NULL;
+#ifdef MADV_HUGEPAGE
+    if (mem && align == TT_HUGE_PAGE_SIZE)
+        madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+    tt_alloc_kind = mem ? TT_ALLOC_ALIGNED : TT_ALLOC_NONE;
+#endif
+    return mem;
 }
 
-// Read TT entry; returns NO_HASH_ENTRY if not found.
-// Searches all 4 entries in the cluster — all fit in one cache line so no extra misses.
-// Also extracts best_move from any matching entry for move ordering (regardless of depth).
-static inline int read_hash_entry(int alpha, int beta, int depth, int *tt_best_move)
+static void tt_free(void)
 {
-    tt_cluster *cluster = &hash_table[hash_key & TT_CLUSTER_MASK];
-    unsigned int hash32 = (unsigned int)(hash_key >> 32);
+    if (!hash_table) return;
+#ifdef WIN64
+    _aligned_free(hash_table);
+#else
+    if (tt_alloc_kind == TT_ALLOC_MMAP) munmap(hash_table, tt_alloc_bytes);
+    else free(hash_table);
+#endif
+    hash_table = NULL;
+    tt_alloc_kind = TT_ALLOC_NONE;
+    tt_alloc_bytes = 0;
+    tt_num_clusters = 0;
+    tt_cluster_mask = 0;
+}
 
-    for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
-        tt_entry *entry = &cluster->entries[i];
-        if (entry->hash32 == hash32) {
-            // Always extract best move for move ordering
-            *tt_best_move = entry->best_move;
+// v2.4: Background TT clear. The table is split into one contiguous slice per
+// search thread and each slice is zeroed by its own helper, so "ucinewgame" and
+// startup return at once and large tables clear in parallel. tt_clear_wait()
+// joins the helpers; call it before anything reads, writes or frees the table.
+typedef struct {
+    U64 first;  // first cluster of the slice
+    U64 count;  // clusters in the slice
+} tt_clear_slice;
 
-            if ((int)entry->depth >= depth) {
-                int score = entry->score;
+// Memory bandwidth saturates long before this many helpers
+#define TT_CLEAR_MAX_THREADS 64
 
-                // Adjust mate scores for search path
-                if (score < -mate_score) score += ply;
-                if (score > mate_score) score -= ply;
+static pthread_t tt_clear_threads[TT_CLEAR_MAX_THREADS];
+static tt_clear_slice tt_clear_slices[TT_CLEAR_MAX_THREADS];
+static int tt_clear_pending = 0;  // helpers started and not yet joined
 
-                if (entry->flag == HASH_FLAG_EXACT)
-                    return score;
-                if (entry->flag == HASH_FLAG_ALPHA && score <= alpha)
-                    return alpha;
-                if (entry->flag == HASH_FLAG_BETA && score >= beta)
+static void *tt_clear_worker(void *arg)
+{
+    tt_clear_slice *slice = (tt_clear_slice *)arg;
+    memset(&hash_table[slice->first], 0, slice->count * sizeof(tt_cluster));
+    return NULL;
+}
+
+void tt_clear_wait()
+{
+    for (int i = 0; i < tt_clear_pending; i++)
+        pthread_join(tt_clear_threads[i], NULL);
+    tt_clear_pending = 0;
+}
+
+// Start clearing the TT in the background (returns before the table is zeroed)
+void clear_hash_table()
+{
+    tt_clear_wait();
+    if (!hash_table) return;
+
+    int helpers = num_threads;
+    if (helpers < 1) helpers = 1;
+    if (helpers > TT_CLEAR_MAX_THREADS) helpers = TT_CLEAR_MAX_THREADS;
+
+    U64 per_slice = tt_num_clusters / helpers;
+    for (int i = 0; i < helpers; i++) {
+        tt_clear_slice *slice = &tt_clear_slices[i];
+        slice->first = i * per_slice;
+        slice->count = (i == helpers - 1) ? tt_num_clusters - slice->first : per_slice;
+        if (pthread_create(&tt_clear_threads[tt_clear_pending], NULL, tt_clear_worker, slice) == 0)
+            tt_clear_pending++;
+        else
+            tt_clear_worker(slice);  // no thread available: clear this slice inline
+    }
+}
+
+// (Re)allocate the TT for the given size in MB and start clearing it.
+// Only call while no search is running.
+void init_hash_table(int mb)
+{
+    tt_clear_wait();  // helpers may still be writing into the old table
+    if (mb < 1) mb = 1;
+    if (mb > TT_MAX_MB) mb = TT_MAX_MB;
+
+    // Largest power-of-two cluster count that fits in the requested size
+    U64 clusters = 1;
+    while (clusters * 2 * sizeof(tt_cluster) <= (U64)mb * 1024 * 1024)
+        clusters *= 2;
+
+    tt_free();
+
+    // Out of memory: halve the request until it fits
+    while (clusters >= 1024) {
+        hash_table = (tt_cluster *)tt_alloc(clusters * sizeof(tt_cluster));
+        if (hash_table) break;
+        clusters /= 2;
+    }
+    if (!hash_table) {
+        fprintf(stderr, "Cannot allocate transposition table\n");
+        exit(1);
+    }
+
+    tt_alloc_bytes  = clusters * sizeof(tt_cluster);
+    tt_num_clusters = clusters;
+    tt_cluster_mask = clusters - 1;
+    clear_hash_table();
+}
+
+// Compact 16-bit TT move: source | target << 6 | promotion type << 12,
+// promotion type 1-4 = N, B, R, Q (colour comes from the side to move).
+static inline int tt_pack_move(int move)
+{
+    if (!move) return 0;
+    int promoted = get_move_promoted(move);
+    int promo_type = promoted ? promoted - (promoted >= p ? p : P) : 0;
+    return get_move_source(move) | (get_move_target(move) << 6) | (promo_type << 12);
+}
+
+// Expand a compact TT move back into a full move for the current position.
+// The moving piece and the capture/double/enpassant/castling flags are recovered
+// from the board; returns 0 if no own piece stands on the source square.
+static inline int tt_unpack_move(position *pos, int move16)
+{
+    if (!move16) return 0;
+    int from = move16 & 0x3f;
+    int to = (move16 >> 6) & 0x3f;
+    int promo_type = (move16 >> 12) & 0x7;
+    U64 from_bb = 1ULL << from;
+    if (!(pos->occupancies[pos->side] & from_bb)) return 0;
+
+    int first = (pos->side == white) ? P : p;
+    int piece = first;
+    while (!(pos->bitboards[piece] & from_bb)) piece++;
+
+    int capture = get_bit(pos->occupancies[pos->side ^ 1], to) ? 1 : 0;
+    int double_push = 0, enpass = 0, castling = 0, promoted = 0;
+    if (piece == first) {
+        if (to - from == 16 || from - to == 16) double_push = 1;
+        if (to == pos->enpassant && (to & 7) != (from & 7)) enpass = capture = 1;
+        if (promo_type) promoted = first + promo_type;
+    } else if (piece == first + 5 && (to - from == 2 || from - to == 2)) {
+        castling = 1;
+    }
+    return encode_move(from, to, piece, promoted, capture, double_push, enpass, castling);
+}
+
+// Load one entry's words once. Returns 1 and sets *data only if the pair verifies
+// against the probing key; torn or foreign entries fail the XOR check.
+static inline int tt_probe_entry(tt_cluster *cluster, int i, U64 key, U64 *data)
+{
+    unsigned int k = __atomic_load_n(&cluster->key[i], __ATOMIC_RELAXED);
+    U64 d = __atomic_load_n(&cluster->data[i], __ATOMIC_RELAXED);
+    if ((k ^ (unsigned int)d ^ (unsigned int)(d >> 32)) != (unsigned int)(key >> 32)) return 0;
+    *data = d;
+    return 1;
+}
+
+// Publish an entry. The two stores may interleave with another thread's, but any
+// mixed pair fails verification in tt_probe_entry().
+static inline void tt_store_entry(tt_cluster *cluster, int i, U64 key, U64 data)
+{
+    __atomic_store_n(&cluster->key[i],
+                     (unsigned int)(key >> 32) ^ (unsigned int)data ^ (unsigned int)(data >> 32),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&cluster->data[i], data, __ATOMIC_RELAXED);
+}
+
+// Read TT entry; returns NO_HASH_ENTRY if not found.
+// Searches every entry in the cluster — all fit in one cache line so no extra misses.
+// Also extracts best_move (for move ordering, regardless of depth) and the cached
+// static eval (TT_EVAL_NONE if absent) from any matching entry.
+static inline int read_hash_entry(position *pos, int alpha, int beta, int depth, int *tt_best_move, int *tt_eval)
+{
+    tt_cluster *cluster = &hash_table[pos->hash_key & tt_cluster_mask];
+
+    search_stats.tt_probes++;
+    for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
+        U64 data;
+        if (tt_probe_entry(cluster, i, pos->hash_key, &data)) {
+            search_stats.tt_hits++;
+            // Always extract best move for move ordering
+            *tt_best_move = tt_unpack_move(pos, TT_MOVE16(data));
+            if (TT_MOVE16(data) && !*tt_best_move) search_stats.tt_collisions++;
+            *tt_eval = TT_EVAL(data);
+
+            if (TT_DEPTH(data) >= depth) {
+                int score = TT_SCORE(data);
+                int flag  = TT_FLAG(data);
+
+                // Adjust mate scores for search path
+                if (score < -mate_score) score += ply;
+                if (score > mate_score) score -= ply;
+
+                if (flag == HASH_FLAG_EXACT)
+                    return score;
+                if (flag == HASH_FLAG_ALPHA && score <= alpha)
+                    return alpha;
+                if (flag == HASH_FLAG_BETA && score >= beta)
                     return beta;
             }
             return NO_HASH_ENTRY;  // Key matched but depth/bound didn't — stop searching
         }
     }
 
+    *tt_eval = TT_EVAL_NONE;
     return NO_HASH_ENTRY;
 }
 
+// Cached static eval for the current position, or TT_EVAL_NONE on a miss
+static inline int read_hash_eval(position *pos)
+{
+    tt_cluster *cluster = &hash_table[pos->hash_key & tt_cluster_mask];
+    search_stats.tt_probes++;
+    for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
+        U64 data;
+        if (tt_probe_entry(cluster, i, pos->hash_key, &data)) {
+            search_stats.tt_hits++;
+            return TT_EVAL(data);
+        }
+    }
+    return TT_EVAL_NONE;
+}
+
+// UCI hashfull: per-mille of the first 1000 entries written by the current search
+static int tt_hashfull()
+{
+    int used = 0;
+    for (int c = 0; c < 1000 / TT_CLUSTER_SIZE; c++)
+        for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
+            U64 d = __atomic_load_n(&hash_table[c].data[i], __ATOMIC_RELAXED);
+            if (d && TT_GEN(d) == (tt_generation & 0x1f)) used++;
+        }
+    return used;
+}
 // Validate a TT-retrieved move against the current board before using it.
 // Prevents hash-collision entries (from ponder or prior searches) from causing
 // illegal moves: checks piece ownership, source-square presence, no own-piece capture.
-static inline int is_tt_move_valid(int move)
+static inline int is_tt_move_valid(position *pos, int move)
 {
     if (!move) return 0;
     int piece = get_move_piece(move);
@@ -3891,29 +4287,28 @@ static inline int is_tt_move_valid(int move)
     int to    = get_move_target(move);
     if (piece > k) return 0;  // bounds check: valid piece indices are 0-11 (k=11)
     // Piece must belong to the side to move (white pieces 0-5, black pieces 6-11)
-    if (((piece >= p) ? black : white) != side) return 0;
+    if (((piece >= p) ? black : white) != pos->side) return 0;
     // Piece must actually be on the source square
-    if (!(bitboards[piece] & (1ULL << from))) return 0;
+    if (!(pos->bitboards[piece] & (1ULL << from))) return 0;
     // Target must not be occupied by an own piece
-    if (occupancies[side] & (1ULL << to)) return 0;
+    if (pos->occupancies[pos->side] & (1ULL << to)) return 0;
     return 1;
 }
 
 // Peek at TT entry for singular extension: returns 1 on hit, populates score/flag/depth.
 // Unlike read_hash_entry, no alpha/beta logic — we want raw stored values.
-static inline int get_tt_info(int *out_score, int *out_flag, int *out_depth)
+static inline int get_tt_info(position *pos, int *out_score, int *out_flag, int *out_depth)
 {
-    tt_cluster *cluster = &hash_table[hash_key & TT_CLUSTER_MASK];
-    unsigned int hash32 = (unsigned int)(hash_key >> 32);
+    tt_cluster *cluster = &hash_table[pos->hash_key & tt_cluster_mask];
     for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
-        tt_entry *e = &cluster->entries[i];
-        if (e->hash32 == hash32) {
-            int s = e->score;
+        U64 data;
+        if (tt_probe_entry(cluster, i, pos->hash_key, &data)) {
+            int s = TT_SCORE(data);
             if (s < -mate_score) s += ply;
             if (s > mate_score) s -= ply;
             *out_score = s;
-            *out_flag  = (int)e->flag;
-            *out_depth = (int)(signed char)e->depth;
+            *out_flag  = TT_FLAG(data);
+            *out_depth = TT_DEPTH(data);
             return 1;
         }
     }
@@ -3922,41 +4317,58 @@ static inline int get_tt_info(int *out_score, int *out_flag, int *out_depth)
 
 // Write TT entry.
 // Replacement policy: prefer to reuse a matching slot (same position);
-// otherwise replace the slot with the lowest depth (least valuable entry).
-static inline void write_hash_entry(int score, int depth, int flag, int best_move)
+// otherwise replace the slot with the lowest depth - TT_AGE_WEIGHT * age
+// (shallow or stale entries are the least valuable).
+// static_eval may be TT_EVAL_NONE, in which case a cached eval already stored
+// for this position is kept.
+static inline void write_hash_entry(position *pos, int score, int depth, int flag, int best_move, int static_eval)
 {
-    tt_cluster *cluster = &hash_table[hash_key & TT_CLUSTER_MASK];
-    unsigned int hash32 = (unsigned int)(hash_key >> 32);
+    tt_cluster *cluster = &hash_table[pos->hash_key & tt_cluster_mask];
 
     // Adjust mate scores for storage
     if (score < -mate_score) score -= ply;
     if (score > mate_score) score += ply;
 
+    if (static_eval != TT_EVAL_NONE) {
+        if (static_eval > 32000) static_eval = 32000;
+        if (static_eval < -32000) static_eval = -32000;
+    }
+    int move16 = tt_pack_move(best_move);
+
     // Find: matching entry to update, OR lowest-depth entry to replace
-    tt_entry *replace = &cluster->entries[0];
+    int replace = -1;
+    int replace_value = 0;
     for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
-        tt_entry *entry = &cluster->entries[i];
-        if (entry->hash32 == hash32) {
-            // Found this position's slot. Update if new depth >= stored.
-            if (depth >= (int)entry->depth) {
-                replace = entry;
+        U64 data;
+        if (tt_probe_entry(cluster, i, pos->hash_key, &data)) {
+            if (static_eval == TT_EVAL_NONE) static_eval = TT_EVAL(data);
+            // Found this position's slot. Update if new depth >= stored,
+            // or if the stored result is from an earlier search. An eval-only
+            // write (HASH_FLAG_NONE) never replaces a stored bound or move.
+            if (flag != HASH_FLAG_NONE && (depth >= TT_DEPTH(data) || TT_AGE(data))) {
+                replace = i;
+                if (!move16) move16 = TT_MOVE16(data);
             } else {
-                // Shallower non-exact result: just refresh the best_move if we have one
-                if (best_move) entry->best_move = best_move;
+                // Shallower or eval-only result: just refresh the best_move / eval if we have them
+                U64 fresh = (data & ~0xffffffffULL)
+                          | TT_PACK(move16 ? move16 : TT_MOVE16(data), static_eval, 0, 0, 0, 0);
+                if (fresh != data)
+                    tt_store_entry(cluster, i, pos->hash_key, fresh);
                 return;
             }
             break;
         }
-        // Track replacement candidate: empty slot or lowest depth
-        if (entry->hash32 == 0 || (int)entry->depth < (int)replace->depth)
-            replace = entry;
+        // Track replacement candidate: empty slot or lowest depth minus age
+        U64 d = __atomic_load_n(&cluster->data[i], __ATOMIC_RELAXED);
+        int entry_value = d ? TT_DEPTH(d) - TT_AGE_WEIGHT * TT_AGE(d) : -32768;
+        if (replace < 0 || entry_value < replace_value) {
+            replace = i;
+            replace_value = entry_value;
+        }
     }
 
-    replace->hash32    = hash32;
-    replace->depth     = (signed char)depth;
-    replace->score     = score;
-    replace->flag      = (unsigned char)flag;
-    replace->best_move = best_move;
+    tt_store_entry(cluster, replace, pos->hash_key,
+                   TT_PACK(move16, static_eval, score, depth, flag, tt_generation));
 }
 
 
@@ -3987,27 +4399,89 @@ static int mvv_lva[12][12] = {
 
 #define max_ply 64
 
-// Killer moves [id][ply]
-int killer_moves[2][max_ply];
+// Outcome of a thread's last completed iteration, used for best-move voting
+typedef struct {
+    int depth;   // iteration number (0 = nothing completed)
+    int score;
+    int move;    // root best move
+    int ponder;  // second PV move, or 0
+    int pv_length;
+    int pv[max_ply];
+} search_result;
+
+// v2.4: Per-search-thread context. The thread running search_position() owns
+// pool_ctx[0] and each Lazy SMP helper one of pool_ctx[1..]; thread_pool_init()
+// allocates exactly one per search thread, so the UCI input, timer and TT-clear
+// threads carry none of this state. It holds everything a search thread needs
+// beyond a few scalars kept in TLS (ply, node counters, the excluded SE move):
+// move-ordering heuristics, PV table and static-eval stack. Helpers never race on
+// the heuristics or bounce their cache lines between cores, and each thread learns
+// its own ordering, which also helps the threads diverge.
+typedef struct {
+    pthread_t thread;
+    int thread_id;
+    int max_depth;
+    unsigned search_id;  // last pool search this helper has picked up
+    position pos;        // private copy of the root, filled in by pool_start_search()
+    cache_stats stats;   // counters handed over when the helper's search ends
+    search_result result;
+
+    // Killer moves [id][ply]
+    int killer_moves[2][max_ply];
 
-// History moves [piece][square]
-int history_moves[12][64];
+    // History moves [piece][square]
+    int history_moves[12][64];
 
-// Countermove heuristic [piece][to_square] — best response to opponent's last move
-int countermove[12][64];
+    // Countermove heuristic [piece][to_square] — best response to opponent's last move
+    int countermove[12][64];
 
-// Previous move tracking for countermove (piece that moved and its destination)
-__thread int prev_move_piece;
-__thread int prev_move_to;
+    // Capture history [attacker_piece][to_sq][captured_piece]
+    int capture_history[12][64][12];
 
-// Static eval history per ply for improving flag
-__thread int static_evals_by_ply[max_ply];
+    // 1-ply continuation history [prev_piece][prev_to][cur_piece][cur_to] (1.2 MB)
+    short cont_hist[12][64][12][64];
 
-// Capture history [attacker_piece][to_sq][captured_piece]
-int capture_history[12][64][12];
+    // Previous move tracking for countermove (piece that moved and its destination)
+    int prev_move_piece;
+    int prev_move_to;
 
-// 1-ply continuation history [prev_piece][prev_to][cur_piece][cur_to]
-short cont_hist[12][64][12][64];
+    // Static eval history per ply for improving flag
+    int static_evals_by_ply[max_ply];
+
+    // PV table
+    int pv_length[max_ply];
+    int pv_table[max_ply][max_ply];
+} WorkerContext;
+
+// Context of the search running on this thread (NULL outside search threads)
+__thread WorkerContext *thread_ctx = NULL;
+
+// Forget the previous search's heuristics, PV and eval stack
+static void clear_search_context(WorkerContext *ctx)
+{
+    memset(ctx->killer_moves, 0, sizeof(ctx->killer_moves));
+    memset(ctx->history_moves, 0, sizeof(ctx->history_moves));
+    memset(ctx->countermove, 0, sizeof(ctx->countermove));
+    memset(ctx->capture_history, 0, sizeof(ctx->capture_history));
+    memset(ctx->cont_hist, 0, sizeof(ctx->cont_hist));
+    ctx->prev_move_piece = 0;
+    ctx->prev_move_to = 0;
+    memset(ctx->static_evals_by_ply, 0, sizeof(ctx->static_evals_by_ply));
+    memset(ctx->pv_table, 0, sizeof(ctx->pv_table));
+    memset(ctx->pv_length, 0, sizeof(ctx->pv_length));
+    memset(&ctx->result, 0, sizeof(ctx->result));
+}
+
+// Record this thread's just-completed iteration (root PV in pv_table[0]) for voting
+static void save_search_result(search_result *result, int depth, int score)
+{
+    result->depth  = depth;
+    result->score  = score;
+    result->move   = thread_ctx->pv_table[0][0];
+    result->ponder = (thread_ctx->pv_length[0] >= 2) ? thread_ctx->pv_table[0][1] : 0;
+    result->pv_length = thread_ctx->pv_length[0] > 0 ? thread_ctx->pv_length[0] : 1;
+    memcpy(result->pv, thread_ctx->pv_table[0], result->pv_length * sizeof(int));
+}
 
 // Correction history: adjusts static_eval based on historical score error
 #ifndef TUNER
@@ -4021,9 +4495,37 @@ static char syzygy_path[256] = "";
 #endif
 #endif
 
-// PV table
-__thread int pv_length[max_ply];
-__thread int pv_table[max_ply][max_ply];
+
+// v2.4: ABDADA-style "currently searching" table, shared by all Lazy SMP threads.
+// A thread marks (position, move) while it searches that child at depth >=
+// ABDADA_MIN_DEPTH; another thread reaching the same node defers the move to the
+// end of its move loop and works on siblings first. Entries are plain stores:
+// a lost race only costs one redundant or deferred search.
+#define ABDADA_SIZE 8192
+#define ABDADA_MASK (ABDADA_SIZE - 1)
+#define ABDADA_MIN_DEPTH 5
+static U64 abdada_table[ABDADA_SIZE];
+
+static inline U64 abdada_key(position *pos, int move)
+{
+    return pos->hash_key ^ ((U64)move * 0x9e3779b97f4a7c15ULL);
+}
+
+static inline int abdada_busy(U64 key)
+{
+    return __atomic_load_n(&abdada_table[key & ABDADA_MASK], __ATOMIC_RELAXED) == key;
+}
+
+static inline void abdada_mark(U64 key)
+{
+    __atomic_store_n(&abdada_table[key & ABDADA_MASK], key, __ATOMIC_RELAXED);
+}
+
+static inline void abdada_unmark(U64 key)
+{
+    if (__atomic_load_n(&abdada_table[key & ABDADA_MASK], __ATOMIC_RELAXED) == key)
+        __atomic_store_n(&abdada_table[key & ABDADA_MASK], 0, __ATOMIC_RELAXED);
+}
 
 // Pre-computed LMR reduction table
 int lmr_table[64][64];
@@ -4033,10 +4535,11 @@ const int futility_margins[3] = {0, 150, 350};
 
 // Time control globals
 int v14_time_budget_ms = 0;    // allocated time for this move in ms
-long v14_search_start = 0;     // start time in ms
+long v14_search_start = 0;     // start time in ms (UCI info time / nps)
+long v14_budget_start = 0;     // v2.4: time the budget runs from: search start, or the ponderhit
 // v14_stopped declared near top of file with other globals
 int v14_hard_limit_ms = 0;     // absolute max time (safety net: don't use >50% of clock)
-#define TIME_CHECK_INTERVAL 4096
+#define PUBLISH_INTERVAL 4096      // nodes between publish_counters() calls
 
 // Initialize LMR table
 void init_lmr_table()
@@ -4046,37 +4549,88 @@ void init_lmr_table()
             lmr_table[d][m] = (int)(1.0 + log(d) * log(m) / 2.5);
 }
 
-// Check if we should stop searching (time + GUI input)
-static inline void check_time()
+// v2.4: Search deadline timer. A single thread, started on first use, sleeps until
+// the armed deadline and then raises v14_stopped; the node loops only load the
+// flag, so stop latency no longer depends on NPS and no thread reads the clock
+// while searching. The deadline is 90% of the budget or the hard limit, whichever
+// comes first. v14_stopped is only set while armed (under timer_mutex), so a
+// disarmed timer can never stop a later search.
+// NOTE: Do NOT read stdin from here — raw read() can consume multiple lines,
+// eating position/go commands meant for the UCI loop.
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t timer_thread;
+static int timer_started = 0;
+static int timer_armed = 0;
+static long timer_start_ms = 0;  // v14_budget_start of the armed search
+static int timer_limit_ms = 0;   // stop this many ms after timer_start_ms
+
+static void *timer_main(void *arg)
 {
-    if (v14_time_budget_ms > 0) {
-        long elapsed = get_time_ms() - v14_search_start;
-        // Normal budget: stop at 90%
-        if (elapsed > (long)(v14_time_budget_ms * 0.9))
-            v14_stopped = 1;
-        // Hard safety limit: never exceed this (prevents losing on time)
-        if (v14_hard_limit_ms > 0 && elapsed > v14_hard_limit_ms)
+    (void)arg;
+    pthread_mutex_lock(&timer_mutex);
+    for (;;) {
+        if (!timer_armed) {
+            pthread_cond_wait(&timer_cond, &timer_mutex);
+            continue;
+        }
+        long remaining = timer_start_ms + timer_limit_ms - get_time_ms();
+        if (remaining <= 0) {
             v14_stopped = 1;
+            timer_armed = 0;
+            continue;
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += remaining / 1000;
+        deadline.tv_nsec += (remaining % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        // Woken early by a re-arm / disarm, or on time: either way re-evaluate
+        pthread_cond_timedwait(&timer_cond, &timer_mutex, &deadline);
     }
-    // NOTE: Do NOT call read_input() here. raw read() can consume
-    // multiple lines from stdin, eating position/go commands meant
-    // for the UCI loop. Time management alone stops the search.
+    return NULL;
+}
+
+// Arm the deadline for a search that started at start_ms (budget <= 0 disarms)
+static void timer_arm(long start_ms, int budget_ms, int hard_limit_ms)
+{
+    pthread_mutex_lock(&timer_mutex);
+    if (!timer_started)
+        timer_started = (pthread_create(&timer_thread, NULL, timer_main, NULL) == 0);
+    int limit = (int)(budget_ms * 0.9);
+    if (hard_limit_ms > 0 && hard_limit_ms < limit) limit = hard_limit_ms;
+    timer_start_ms = start_ms;
+    timer_limit_ms = limit;
+    timer_armed = (budget_ms > 0);
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_mutex);
+}
+
+static void timer_disarm(void)
+{
+    pthread_mutex_lock(&timer_mutex);
+    timer_armed = 0;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_mutex);
 }
 
 // Is current position in check?
-static inline int is_in_check()
+static inline int is_in_check(position *pos)
 {
-    if (side == white)
-        return is_square_attacked(get_ls1b_index(bitboards[K]), black);
+    if (pos->side == white)
+        return is_square_attacked(pos, get_ls1b_index(pos->bitboards[K]), black);
     else
-        return is_square_attacked(get_ls1b_index(bitboards[k]), white);
+        return is_square_attacked(pos, get_ls1b_index(pos->bitboards[k]), white);
 }
 
 // Repetition detection
-static inline int is_repetition()
+static inline int is_repetition(position *pos)
 {
-    for (int i = 0; i < repetition_index; i++)
-        if (repetition_table[i] == hash_key)
+    for (int i = 0; i < pos->repetition_index; i++)
+        if (pos->repetition_table[i] == pos->hash_key)
             return 1;
     return 0;
 }
@@ -4085,25 +4639,25 @@ static inline int is_repetition()
 static const int see_piece_val[12] = {100, 300, 300, 500, 900, 20000, 100, 300, 300, 500, 900, 20000};
 
 // Returns bitboard of all pieces attacking square sq with the given occupancy
-static inline U64 get_attackers_to(int sq, U64 occ)
+static inline U64 get_attackers_to(position *pos, int sq, U64 occ)
 {
-    return (pawn_attacks[black][sq] & bitboards[P]) |
-           (pawn_attacks[white][sq] & bitboards[p]) |
-           (knight_attacks[sq]      & (bitboards[N] | bitboards[n])) |
-           (get_bishop_attacks(sq, occ) & (bitboards[B] | bitboards[b] | bitboards[Q] | bitboards[q])) |
-           (get_rook_attacks(sq, occ)   & (bitboards[R] | bitboards[r] | bitboards[Q] | bitboards[q])) |
-           (king_attacks[sq]        & (bitboards[K] | bitboards[k]));
+    return (pawn_attacks[black][sq] & pos->bitboards[P]) |
+           (pawn_attacks[white][sq] & pos->bitboards[p]) |
+           (knight_attacks[sq]      & (pos->bitboards[N] | pos->bitboards[n])) |
+           (get_bishop_attacks(sq, occ) & (pos->bitboards[B] | pos->bitboards[b] | pos->bitboards[Q] | pos->bitboards[q])) |
+           (get_rook_attacks(sq, occ)   & (pos->bitboards[R] | pos->bitboards[r] | pos->bitboards[Q] | pos->bitboards[q])) |
+           (king_attacks[sq]        & (pos->bitboards[K] | pos->bitboards[k]));
 }
 
 // Static Exchange Evaluation: returns estimated net material gain for a capture.
 // Positive = winning/equal capture, negative = losing.
 // attacker_piece: piece enum (0-11) of the initial capturer
 // target_val: value in cp of the piece being captured
-static int see(int from_sq, int to_sq, int attacker_piece, int target_val)
+static int see(position *pos, int from_sq, int to_sq, int attacker_piece, int target_val)
 {
     int gain[32], d = 0;
-    U64 occ = occupancies[both];
-    U64 attadef = get_attackers_to(to_sq, occ);
+    U64 occ = pos->occupancies[both];
+    U64 attadef = get_attackers_to(pos, to_sq, occ);
 
     gain[d] = target_val;
 
@@ -4118,8 +4672,8 @@ static int see(int from_sq, int to_sq, int attacker_piece, int target_val)
         // Remove this attacker and reveal x-ray pieces
         occ     ^= from_bb;
         attadef ^= from_bb;
-        attadef |= get_bishop_attacks(to_sq, occ) & (bitboards[B] | bitboards[b] | bitboards[Q] | bitboards[q]);
-        attadef |= get_rook_attacks(to_sq, occ)   & (bitboards[R] | bitboards[r] | bitboards[Q] | bitboards[q]);
+        attadef |= get_bishop_attacks(to_sq, occ) & (pos->bitboards[B] | pos->bitboards[b] | pos->bitboards[Q] | pos->bitboards[q]);
+        attadef |= get_rook_attacks(to_sq, occ)   & (pos->bitboards[R] | pos->bitboards[r] | pos->bitboards[Q] | pos->bitboards[q]);
         attadef &= occ;
 
         stm ^= 1;
@@ -4129,7 +4683,7 @@ static int see(int from_sq, int to_sq, int attacker_piece, int target_val)
         from_bb = 0ULL;
         int start = stm * 6;
         for (int pc = start; pc < start + 6; pc++) {
-            U64 s = attadef & bitboards[pc];
+            U64 s = attadef & pos->bitboards[pc];
             if (s) {
                 next_piece = pc;
                 from_bb = s & (-s);  // isolate LSB
@@ -4147,7 +4701,7 @@ static int see(int from_sq, int to_sq, int attacker_piece, int target_val)
 
 // Score a move for ordering
 // Priority: TT move (2M) > winning captures MVV-LVA (1M+) > killer (900k/800k) > countermove (700k) > losing captures (500k+) > history
-static inline int score_move(int move, int tt_move)
+static inline int score_move(position *pos, int move, int tt_move)
 {
     // TT move gets highest priority
     if (move == tt_move)
@@ -4155,20 +4709,13 @@ static inline int score_move(int move, int tt_move)
 
     // Captures: use SEE to split winning (>=0) and losing (<0) captures
     if (get_move_capture(move)) {
-        int target_piece = P;
-        int start_piece = (side == white) ? p : P;
-        int end_piece = (side == white) ? k : K;
-
-        for (int bb_piece = start_piece; bb_piece <= end_piece; bb_piece++) {
-            if (get_bit(bitboards[bb_piece], get_move_target(move))) {
-                target_piece = bb_piece;
-                break;
-            }
-        }
-        int see_val = see(get_move_source(move), get_move_target(move),
+        // en passant lands on an empty square; score it as a pawn capture
+        int target_piece = pos->board[get_move_target(move)];
+        if (target_piece == NO_PIECE) target_piece = P;
+        int see_val = see(pos, get_move_source(move), get_move_target(move),
                           get_move_piece(move), see_piece_val[target_piece]);
         // Add capture_history as tiebreaker within SEE groups (capped to ±400)
-        int ch_bonus = capture_history[get_move_piece(move)][get_move_target(move)][target_piece];
+        int ch_bonus = thread_ctx->capture_history[get_move_piece(move)][get_move_target(move)][target_piece];
         if (ch_bonus >  400) ch_bonus =  400;
         if (ch_bonus < -400) ch_bonus = -400;
         if (see_val >= 0)
@@ -4178,18 +4725,18 @@ static inline int score_move(int move, int tt_move)
     }
 
     // Killer moves
-    if (killer_moves[0][ply] == move) return 900000;
-    if (killer_moves[1][ply] == move) return 800000;
+    if (thread_ctx->killer_moves[0][ply] == move) return 900000;
+    if (thread_ctx->killer_moves[1][ply] == move) return 800000;
 
     // Countermove heuristic: response to opponent's last move
-    if (prev_move_piece && countermove[prev_move_piece][prev_move_to] == move)
+    if (thread_ctx->prev_move_piece && thread_ctx->countermove[thread_ctx->prev_move_piece][thread_ctx->prev_move_to] == move)
         return 700000;
 
     // History heuristic + 1-ply continuation history
     {
-        int hist = history_moves[get_move_piece(move)][get_move_target(move)];
-        if (prev_move_piece) {
-            int cont = cont_hist[prev_move_piece][prev_move_to][get_move_piece(move)][get_move_target(move)];
+        int hist = thread_ctx->history_moves[get_move_piece(move)][get_move_target(move)];
+        if (thread_ctx->prev_move_piece) {
+            int cont = thread_ctx->cont_hist[thread_ctx->prev_move_piece][thread_ctx->prev_move_to][get_move_piece(move)][get_move_target(move)];
             hist += cont;
         }
         return hist;
@@ -4197,10 +4744,10 @@ static inline int score_move(int move, int tt_move)
 }
 
 // Score all moves into caller-supplied array (lazy sort phase 1)
-static inline void score_moves(moves *move_list, int *move_scores, int tt_move)
+static inline void score_moves(position *pos, moves *move_list, int *move_scores, int tt_move)
 {
     for (int i = 0; i < move_list->count; i++)
-        move_scores[i] = score_move(move_list->moves[i], tt_move);
+        move_scores[i] = score_move(pos, move_list->moves[i], tt_move);
 }
 
 // Swap the best remaining move into position `start` (lazy sort phase 2, called per iteration)
@@ -4215,74 +4762,313 @@ static inline void pick_best_move(moves *move_list, int *move_scores, int start)
     }
 }
 
-// Quiescence search
-static inline int quiescence(int alpha, int beta)
+// v2.4: is a killer or countermove from another node a legal quiet move here?
+// The move must match exactly what generate_moves() would emit (piece on its
+// source, empty target, pawn push / double push / promotion and castling flags
+// consistent with the geometry), and must not leave our king attacked: like the
+// en passant test of generate_legal(), the move is replayed on the occupancy and
+// the king checked against every enemy piece, which covers checks, blocks and pins.
+static inline int is_quiet_move_legal(position *pos, int move)
+{
+    if (!move || get_move_capture(move) || get_move_enpassant(move)) return 0;
+
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    int piece = get_move_piece(move);
+    int promoted = get_move_promoted(move);
+    int side = pos->side;
+    int offset = side * 6;
+    U64 occupancy = pos->occupancies[both];
+
+    if (piece < P + offset || piece > K + offset || pos->board[source_square] != piece) return 0;
+    if (get_bit(occupancy, target_square)) return 0;
+
+    // castling: same conditions as generate_legal()
+    if (get_move_castling(move))
+    {
+        if (piece != K + offset || promoted || get_move_double(move)) return 0;
+        if (is_square_attacked(pos, source_square, side ^ 1)) return 0;
+
+        if (side == white)
+        {
+            if (move == (encode_move(e1, g1, K, 0, 0, 0, 0, 1)))
+                return (pos->castle & wk) && !get_bit(occupancy, f1) &&
+                       !is_square_attacked(pos, f1, black) && !is_square_attacked(pos, g1, black);
+            if (move == (encode_move(e1, c1, K, 0, 0, 0, 0, 1)))
+                return (pos->castle & wq) && !get_bit(occupancy, d1) && !get_bit(occupancy, b1) &&
+                       !is_square_attacked(pos, d1, black) && !is_square_attacked(pos, c1, black);
+        }
+        else
+        {
+            if (move == (encode_move(e8, g8, k, 0, 0, 0, 0, 1)))
+                return (pos->castle & bk) && !get_bit(occupancy, f8) &&
+                       !is_square_attacked(pos, f8, white) && !is_square_attacked(pos, g8, white);
+            if (move == (encode_move(e8, c8, k, 0, 0, 0, 0, 1)))
+                return (pos->castle & bq) && !get_bit(occupancy, d8) && !get_bit(occupancy, b8) &&
+                       !is_square_attacked(pos, d8, white) && !is_square_attacked(pos, c8, white);
+        }
+        return 0;
+    }
+
+    // move geometry
+    U64 target_bit = 1ULL << target_square;
+    switch (piece - offset)
+    {
+        case P:
+        {
+            int push = (side == white) ? -8 : 8;
+            U64 promotion_rank = (side == white) ? 0x00000000000000FFULL : 0xFF00000000000000ULL;
+            U64 start_rank = (side == white) ? 0x00FF000000000000ULL : 0x000000000000FF00ULL;
+
+            if (get_move_double(move)) {
+                if (promoted || !get_bit(start_rank, source_square) || target_square != source_square + 2 * push ||
+                    get_bit(occupancy, source_square + push))
+                    return 0;
+            }
+            else {
+                if (target_square != source_square + push) return 0;
+                // promotion exactly when the push reaches the last rank
+                if ((promotion_rank & target_bit) ? (promoted < N + offset || promoted > Q + offset) : promoted)
+                    return 0;
+            }
+            break;
+        }
+        case N: if (!(knight_attacks[source_square] & target_bit)) return 0; break;
+        case B: if (!(get_bishop_attacks(source_square, occupancy) & target_bit)) return 0; break;
+        case R: if (!(get_rook_attacks(source_square, occupancy) & target_bit)) return 0; break;
+        case Q: if (!(get_queen_attacks(source_square, occupancy) & target_bit)) return 0; break;
+        default: if (!(king_attacks[source_square] & target_bit)) return 0; break;
+    }
+    if (piece != P + offset && (promoted || get_move_double(move))) return 0;
+
+    // king safety after the move (the target is empty, so nothing is captured)
+    int king_square = (piece == K + offset) ? target_square : get_ls1b_index(pos->bitboards[K + offset]);
+    U64 occupancy_after = (occupancy ^ (1ULL << source_square)) | target_bit;
+
+    return !attackers_of_side(pos, king_square, side ^ 1, occupancy_after);
+}
+
+// v2.4: Staged move picker for negamax. Moves come out in stages and each stage
+// only generates and scores what it hands out, so a cutoff on an early capture or
+// killer skips generating the quiets at all. Killers and the countermove are
+// checked with is_quiet_move_legal() and tried before the quiets are generated;
+// the quiet list then leaves out the TT move (tried by negamax before the picker
+// runs) and whatever the killer stages already returned.
+enum {
+    STAGE_GEN_CAPTURES,   // generate and SEE-score captures only
+    STAGE_GOOD_CAPTURES,  // SEE >= 0, MVV-LVA + capture history order
+    STAGE_KILLER_1,
+    STAGE_KILLER_2,
+    STAGE_COUNTERMOVE,
+    STAGE_GEN_QUIETS,     // generate and history-score the remaining quiets
+    STAGE_QUIETS,
+    STAGE_BAD_CAPTURES,   // SEE < 0, same order as good captures
+    STAGE_DONE
+};
+
+typedef struct {
+    int stage;
+    int tt_move;
+    int killer_1, killer_2, counter;  // cleared unless returned by their stage
+    moves captures[1];
+    moves quiets[1];
+    int capture_scores[256];
+    int quiet_scores[256];
+    int capture_index;                // next capture to pick
+    int quiet_index;                  // next quiet to pick
+} move_picker;
+
+static inline void init_move_picker(move_picker *picker, int tt_move)
+{
+    picker->stage = STAGE_GEN_CAPTURES;
+    picker->tt_move = tt_move;
+    picker->killer_1 = thread_ctx->killer_moves[0][ply];
+    picker->killer_2 = thread_ctx->killer_moves[1][ply];
+    picker->counter = thread_ctx->prev_move_piece ? thread_ctx->countermove[thread_ctx->prev_move_piece][thread_ctx->prev_move_to] : 0;
+}
+
+// Next legal move in stage order, 0 when the node is exhausted
+static inline int next_move(position *pos, move_picker *picker)
+{
+    int move;
+
+    switch (picker->stage)
+    {
+        case STAGE_GEN_CAPTURES:
+        {
+            moves move_list[1];
+            generate_captures(pos, move_list);
+            picker->captures->count = 0;
+            for (int i = 0; i < move_list->count; i++) {
+                move = move_list->moves[i];
+                // quiet queen promotions are handed out with the quiets
+                if (move == picker->tt_move || !get_move_capture(move)) continue;
+                picker->capture_scores[picker->captures->count] = score_move(pos, move, 0);
+                picker->captures->moves[picker->captures->count++] = move;
+            }
+            picker->capture_index = 0;
+            picker->stage = STAGE_GOOD_CAPTURES;
+        }
+        // fall through
+
+        case STAGE_GOOD_CAPTURES:
+            if (picker->capture_index < picker->captures->count) {
+                pick_best_move(picker->captures, picker->capture_scores, picker->capture_index);
+                // losing captures (score below 1000000) wait for STAGE_BAD_CAPTURES
+                if (picker->capture_scores[picker->capture_index] >= 1000000)
+                    return picker->captures->moves[picker->capture_index++];
+            }
+            picker->stage = STAGE_KILLER_1;
+            // fall through
+
+        case STAGE_KILLER_1:
+            picker->stage = STAGE_KILLER_2;
+            if (picker->killer_1 == picker->tt_move || !is_quiet_move_legal(pos, picker->killer_1))
+                picker->killer_1 = 0;
+            else
+                return picker->killer_1;
+            // fall through
+
+        case STAGE_KILLER_2:
+            picker->stage = STAGE_COUNTERMOVE;
+            if (picker->killer_2 == picker->tt_move || picker->killer_2 == picker->killer_1 ||
+                !is_quiet_move_legal(pos, picker->killer_2))
+                picker->killer_2 = 0;
+            else
+                return picker->killer_2;
+            // fall through
+
+        case STAGE_COUNTERMOVE:
+            picker->stage = STAGE_GEN_QUIETS;
+            if (picker->counter == picker->tt_move || picker->counter == picker->killer_1 ||
+                picker->counter == picker->killer_2 || !is_quiet_move_legal(pos, picker->counter))
+                picker->counter = 0;
+            else
+                return picker->counter;
+            // fall through
+
+        case STAGE_GEN_QUIETS:
+        {
+            moves move_list[1];
+            generate_quiets(pos, move_list);
+            picker->quiets->count = 0;
+            for (int i = 0; i < move_list->count; i++) {
+                move = move_list->moves[i];
+                if (move == picker->tt_move || move == picker->killer_1 ||
+                    move == picker->killer_2 || move == picker->counter)
+                    continue;
+                picker->quiet_scores[picker->quiets->count] = score_move(pos, move, 0);
+                picker->quiets->moves[picker->quiets->count++] = move;
+            }
+            picker->quiet_index = 0;
+            picker->stage = STAGE_QUIETS;
+        }
+        // fall through
+
+        case STAGE_QUIETS:
+            if (picker->quiet_index < picker->quiets->count) {
+                pick_best_move(picker->quiets, picker->quiet_scores, picker->quiet_index);
+                return picker->quiets->moves[picker->quiet_index++];
+            }
+            picker->stage = STAGE_BAD_CAPTURES;
+            // fall through
+
+        case STAGE_BAD_CAPTURES:
+            if (picker->capture_index < picker->captures->count) {
+                pick_best_move(picker->captures, picker->capture_scores, picker->capture_index);
+                return picker->captures->moves[picker->capture_index++];
+            }
+            picker->stage = STAGE_DONE;
+            // fall through
+
+        default:
+            return 0;
+    }
+}
+
+// Quiescence search (v2.4: qs_depth is 0 at the first ply and drops by one per
+// ply; the first ply also tries quiet checks)
+static inline int quiescence(position *pos, int alpha, int beta, int qs_depth)
 {
     nodes++;
 
-    // Time check
-    if ((nodes & (TIME_CHECK_INTERVAL - 1)) == 0)
-        check_time();
+    // Keep this thread's published node count fresh (deadlines come from the timer)
+    if ((nodes & (PUBLISH_INTERVAL - 1)) == 0)
+        publish_counters();
 
     if (v14_stopped) return 0;
 
     if (ply > max_ply - 1)
-        return evaluate();
+        return evaluate(pos);
 
-    int stand_pat = evaluate();
+    // v2.4: in check there is no stand pat and every legal evasion is searched
+    int in_check = is_in_check(pos);
 
-    if (stand_pat >= beta)
-        return beta;
+    if (!in_check) {
+#ifndef TUNER
+        // Static eval comes from the TT when this position has been seen; on a miss,
+        // cache it in an eval-only entry (lowest depth, so it is replaced first)
+        int stand_pat = read_hash_eval(pos);
+        search_stats.eval_probes++;
+        if (stand_pat != TT_EVAL_NONE) {
+            search_stats.eval_hits++;
+        } else {
+            stand_pat = evaluate(pos);
+            write_hash_entry(pos, 0, -128, HASH_FLAG_NONE, 0, stand_pat);
+        }
+#else
+        int stand_pat = evaluate(pos);
+#endif
 
-    // Delta pruning: if stand_pat + queen value can't raise alpha, prune
-    if (stand_pat + 900 < alpha)
-        return alpha;
+        if (stand_pat >= beta)
+            return beta;
 
-    if (stand_pat > alpha)
-        alpha = stand_pat;
+        // Delta pruning: if stand_pat + queen value can't raise alpha, prune
+        if (stand_pat + 900 < alpha)
+            return alpha;
 
-    // Generate all moves, filter to captures only
+        if (stand_pat > alpha)
+            alpha = stand_pat;
+    }
+
+    // Generate captures and quiet queen promotions only (all evasions in check)
     moves move_list[1];
-    generate_moves(move_list);
+    if (in_check)
+        generate_moves(pos, move_list);
+    else
+        generate_captures(pos, move_list);
+
+    // checkmate
+    if (in_check && move_list->count == 0)
+        return -mate_value + ply;
+
     int move_scores[256];
-    score_moves(move_list, move_scores, 0);
+    score_moves(pos, move_list, move_scores, 0);
 
     for (int count = 0; count < move_list->count; count++) {
         pick_best_move(move_list, move_scores, count);
         int move = move_list->moves[count];
 
-        // Skip non-captures unless it's a quiet queen promotion
-        if (!get_move_capture(move) && get_move_promoted(move) != Q) continue;
-
         // SEE filter: skip captures that lose material (e.g. QxP defended by pawn)
-        {
-            int tp = P;
-            int sp = (side == white) ? p : P;
-            int ep = (side == white) ? k : K;
-            for (int bb_pc = sp; bb_pc <= ep; bb_pc++) {
-                if (get_bit(bitboards[bb_pc], get_move_target(move))) { tp = bb_pc; break; }
-            }
-            if (see(get_move_source(move), get_move_target(move),
+        if (!in_check) {
+            int tp = pos->board[get_move_target(move)];
+            if (tp == NO_PIECE) tp = P;
+            if (see(pos, get_move_source(move), get_move_target(move),
                     get_move_piece(move), see_piece_val[tp]) < 0)
                 continue;
         }
 
-        copy_board();
         ply++;
-        repetition_index++;
-        repetition_table[repetition_index] = hash_key;
+        pos->repetition_index++;
+        pos->repetition_table[pos->repetition_index] = pos->hash_key;
 
-        if (make_move(move, all_moves) == 0) {
-            ply--;
-            repetition_index--;
-            continue;
-        }
+        make_move(pos, move, legal_moves);
 
-        int score = -quiescence(-beta, -alpha);
+        int score = -quiescence(pos, -beta, -alpha, qs_depth - 1);
 
         ply--;
-        repetition_index--;
-        take_back();
+        pos->repetition_index--;
+        unmake_move(pos);
 
         if (v14_stopped) return 0;
 
@@ -4293,40 +5079,77 @@ static inline int quiescence(int alpha, int beta)
         }
     }
 
+    // v2.4: quiet checks at the first ply, so mates and forks just below the
+    // horizon are seen; checks that simply hang the checking piece are skipped
+    if (qs_depth == 0 && !in_check) {
+        generate_quiet_checks(pos, move_list);
+
+        for (int count = 0; count < move_list->count; count++) {
+            int move = move_list->moves[count];
+
+            if (see(pos, get_move_source(move), get_move_target(move), get_move_piece(move), 0) < 0)
+                continue;
+
+            ply++;
+            pos->repetition_index++;
+            pos->repetition_table[pos->repetition_index] = pos->hash_key;
+
+            make_move(pos, move, legal_moves);
+
+            int score = -quiescence(pos, -beta, -alpha, qs_depth - 1);
+
+            ply--;
+            pos->repetition_index--;
+            unmake_move(pos);
+
+            if (v14_stopped) return 0;
+
+            if (score > alpha) {
+                alpha = score;
+                if (score >= beta)
+                    return beta;
+            }
+        }
+    }
+
     return alpha;
 }
 
 // Negamax with alpha-beta, TT, null move, LMR, PVS, futility pruning
-static inline int negamax(int alpha, int beta, int depth, int null_ok)
+static inline int negamax(position *pos, int alpha, int beta, int depth, int null_ok)
 {
     nodes++;
 
-    // Time check
-    if ((nodes & (TIME_CHECK_INTERVAL - 1)) == 0)
-        check_time();
+    // Keep this thread's published node count fresh (deadlines come from the timer)
+    if ((nodes & (PUBLISH_INTERVAL - 1)) == 0)
+        publish_counters();
 
     if (v14_stopped) return 0;
 
     // Init PV length
-    pv_length[ply] = ply;
+    thread_ctx->pv_length[ply] = ply;
 
     // Repetition detection
-    if (ply && is_repetition())
+    if (ply && is_repetition(pos))
         return 0;
 
     // v16: 50-move rule draw detection
-    if (ply && halfmove_clock >= 100)
+    if (ply && pos->halfmove_clock >= 100)
         return 0;
 
     // PV node flag
     int pv_node = (beta - alpha > 1);
 
     // TT lookup (prefetch full 64-byte cluster into cache before other work)
-    __builtin_prefetch(&hash_table[hash_key & TT_CLUSTER_MASK], 0, 1);
+    __builtin_prefetch(&hash_table[pos->hash_key & tt_cluster_mask], 0, 1);
     int tt_best_move = 0;
+    int tt_eval = TT_EVAL_NONE;
     if (ply) {
-        int tt_score = read_hash_entry(alpha, beta, depth, &tt_best_move);
-        if (!is_tt_move_valid(tt_best_move)) tt_best_move = 0;
+        int tt_score = read_hash_entry(pos, alpha, beta, depth, &tt_best_move, &tt_eval);
+        if (tt_best_move && !is_tt_move_valid(pos, tt_best_move)) {
+            search_stats.tt_collisions++;
+            tt_best_move = 0;
+        }
         if (tt_score != NO_HASH_ENTRY && !pv_node)
             return tt_score;
     }
@@ -4345,27 +5168,28 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
         }
     }
 
-    int in_check = is_in_check();
+    int in_check = is_in_check(pos);
     int raw_eval = 0; // for correction history (set below when !in_check)
+    int node_eval = TT_EVAL_NONE; // static eval stored alongside this node's TT entry
 
 #ifndef TUNER
     // Syzygy WDL probe — interior nodes only (ply > 0), skip in check
     if (TB_LARGEST > 0 && !in_check && ply > 0 &&
-        count_bits(occupancies[both]) <= (int)TB_LARGEST) {
+        count_bits(pos->occupancies[both]) <= (int)TB_LARGEST) {
         // BBC squares: a8=0..h1=63 (top-down); fathom: a1=0..h8=63 (bottom-up)
         // __builtin_bswap64 flips all 8 ranks simultaneously (equiv to XOR-56 per bit)
-        unsigned ep_sq = (enpassant != no_sq) ? (enpassant ^ 56) : 0;
+        unsigned ep_sq = (pos->enpassant != no_sq) ? (pos->enpassant ^ 56) : 0;
         unsigned wdl = tb_probe_wdl_impl(
-            __builtin_bswap64(occupancies[white]),
-            __builtin_bswap64(occupancies[black]),
-            __builtin_bswap64(bitboards[K] | bitboards[k]),
-            __builtin_bswap64(bitboards[Q] | bitboards[q]),
-            __builtin_bswap64(bitboards[R] | bitboards[r]),
-            __builtin_bswap64(bitboards[B] | bitboards[b]),
-            __builtin_bswap64(bitboards[N] | bitboards[n]),
-            __builtin_bswap64(bitboards[P] | bitboards[p]),
+            __builtin_bswap64(pos->occupancies[white]),
+            __builtin_bswap64(pos->occupancies[black]),
+            __builtin_bswap64(pos->bitboards[K] | pos->bitboards[k]),
+            __builtin_bswap64(pos->bitboards[Q] | pos->bitboards[q]),
+            __builtin_bswap64(pos->bitboards[R] | pos->bitboards[r]),
+            __builtin_bswap64(pos->bitboards[B] | pos->bitboards[b]),
+            __builtin_bswap64(pos->bitboards[N] | pos->bitboards[n]),
+            __builtin_bswap64(pos->bitboards[P] | pos->bitboards[p]),
             ep_sq,
-            (side == white)
+            (pos->side == white)
         );
         if (wdl != TB_RESULT_FAILED) {
             tb_hits++;
@@ -4379,7 +5203,7 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
             }
             int flag = score <= alpha ? HASH_FLAG_ALPHA :
                        score >= beta  ? HASH_FLAG_BETA  : HASH_FLAG_EXACT;
-            write_hash_entry(score, depth, flag, 0);
+            write_hash_entry(pos, score, depth, flag, 0, TT_EVAL_NONE);
             return score;
         }
     }
@@ -4391,44 +5215,41 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
 
     // Drop to quiescence at depth 0
     if (depth <= 0)
-        return quiescence(alpha, beta);
+        return quiescence(pos, alpha, beta, 0);
 
     // Max ply overflow (>= prevents pv_table[ply+1] OOB at ply=63)
     if (ply >= max_ply - 1)
-        return evaluate();
+        return evaluate(pos);
 
 #ifndef TUNER
     // Compute raw static eval for correction history (all real non-check nodes)
     int improving = 0;
     if (!in_check) {
-        raw_eval = evaluate() + 10;
-        if (ply < max_ply) static_evals_by_ply[ply] = raw_eval;
-        improving = (ply >= 2 && raw_eval > static_evals_by_ply[ply - 2]);
+        // Reuse the static eval cached in the TT entry when there is one
+        search_stats.eval_probes++;
+        if (tt_eval != TT_EVAL_NONE) search_stats.eval_hits++;
+        node_eval = (tt_eval != TT_EVAL_NONE) ? tt_eval : evaluate(pos);
+        raw_eval = node_eval + 10;
+        if (ply < max_ply) thread_ctx->static_evals_by_ply[ply] = raw_eval;
+        improving = (ply >= 2 && raw_eval > thread_ctx->static_evals_by_ply[ply - 2]);
     }
 #endif
 
     // Null move pruning
-    int game_phase = get_game_phase();
+    int game_phase = get_game_phase(pos);
     if (null_ok && !in_check && game_phase >= PHASE_THRESHOLD && depth >= 3 && ply) {
-        copy_board();
         ply++;
-        repetition_index++;
-        repetition_table[repetition_index] = hash_key;
-
-        // Hash out en passant
-        if (enpassant != no_sq) hash_key ^= enpassant_keys[enpassant];
-        enpassant = no_sq;
+        pos->repetition_index++;
+        pos->repetition_table[pos->repetition_index] = pos->hash_key;
 
-        // Switch side
-        side ^= 1;
-        hash_key ^= side_key;
+        make_null_move(pos);
 
         int R = 3 + depth / 6 + (!improving); if (R >= depth) R = depth - 1;
-        int null_score = -negamax(-beta, -beta + 1, depth - 1 - R, 0);
+        int null_score = -negamax(pos, -beta, -beta + 1, depth - 1 - R, 0);
 
         ply--;
-        repetition_index--;
-        take_back();
+        pos->repetition_index--;
+        unmake_null_move(pos);
 
         if (v14_stopped) return 0;
 
@@ -4440,48 +5261,43 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
     if (!pv_node && depth >= 5 && !in_check &&
         beta > -mate_score && beta < mate_score) {
         int pc_beta = beta + 200;
-        int saved_cm_p = prev_move_piece, saved_cm_t = prev_move_to;
+        int saved_cm_p = thread_ctx->prev_move_piece, saved_cm_t = thread_ctx->prev_move_to;
         moves pc_list[1];
-        generate_moves(pc_list);
+        generate_captures(pos, pc_list);
         for (int pi = 0; pi < pc_list->count; pi++) {
             int pc_move = pc_list->moves[pi];
             if (!get_move_capture(pc_move)) continue;
 
             // Quick SEE filter
-            int tp = P;
-            { int sp2 = (side == white) ? p : P, ep2 = (side == white) ? k : K;
-              for (int bpc = sp2; bpc <= ep2; bpc++)
-                  if (get_bit(bitboards[bpc], get_move_target(pc_move))) { tp = bpc; break; } }
-            if (see(get_move_source(pc_move), get_move_target(pc_move),
+            int tp = pos->board[get_move_target(pc_move)];
+            if (tp == NO_PIECE) tp = P;
+            if (see(pos, get_move_source(pc_move), get_move_target(pc_move),
                     get_move_piece(pc_move), see_piece_val[tp]) < pc_beta - beta - 1)
                 continue;
 
-            copy_board();
             ply++;
-            repetition_index++;
-            repetition_table[repetition_index] = hash_key;
-            prev_move_piece = get_move_piece(pc_move);
-            prev_move_to    = get_move_target(pc_move);
+            pos->repetition_index++;
+            pos->repetition_table[pos->repetition_index] = pos->hash_key;
+            thread_ctx->prev_move_piece = get_move_piece(pc_move);
+            thread_ctx->prev_move_to    = get_move_target(pc_move);
 
-            if (make_move(pc_move, all_moves) == 0) {
-                ply--; repetition_index--; continue;
-            }
+            make_move(pos, pc_move, legal_moves);
 
-            int pc_score = -negamax(-pc_beta, -pc_beta + 1, depth - 4, 0);
+            int pc_score = -negamax(pos, -pc_beta, -pc_beta + 1, depth - 4, 0);
 
             ply--;
-            repetition_index--;
-            take_back();
+            pos->repetition_index--;
+            unmake_move(pos);
 
             if (v14_stopped) return 0;
             if (pc_score >= pc_beta) {
-                prev_move_piece = saved_cm_p;
-                prev_move_to    = saved_cm_t;
+                thread_ctx->prev_move_piece = saved_cm_p;
+                thread_ctx->prev_move_to    = saved_cm_t;
                 return pc_beta;
             }
         }
-        prev_move_piece = saved_cm_p;
-        prev_move_to    = saved_cm_t;
+        thread_ctx->prev_move_piece = saved_cm_p;
+        thread_ctx->prev_move_to    = saved_cm_t;
     }
 
     // Futility pruning setup (compute eval once for both forward and reverse)
@@ -4489,10 +5305,10 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
     if (depth <= 3 && !in_check && !pv_node) {
         // Tempo bonus: side to move has a slight initiative advantage (+10 cp)
 #ifndef TUNER
-        int corr = corr_hist[hash_key & CORR_MASK];
+        int corr = corr_hist[pos->hash_key & CORR_MASK];
         int static_eval = raw_eval + corr / CORR_GRAIN;
 #else
-        int static_eval = evaluate() + 10;
+        int static_eval = evaluate(pos) + 10;
 #endif
 
         // Reverse futility pruning: if eval - margin >= beta, this node is too good
@@ -4512,14 +5328,14 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
         // v19: Razoring — at depth 1, if even with a generous margin we can't beat alpha,
         // fall straight into quiescence rather than wasting time on quiet moves
         if (depth == 1 && static_eval + 450 <= alpha)
-            return quiescence(alpha, beta);
+            return quiescence(pos, alpha, beta, 0);
     }
 
     // v16: IID — if PV node with no TT move and deep enough, do shallow search for move ordering
     if (pv_node && tt_best_move == 0 && depth >= 5) {
-        negamax(alpha, beta, depth - 2, 0);
-        read_hash_entry(alpha, beta, depth, &tt_best_move);
-        if (!is_tt_move_valid(tt_best_move)) tt_best_move = 0;
+        negamax(pos, alpha, beta, depth - 2, 0);
+        read_hash_entry(pos, alpha, beta, depth, &tt_best_move, &tt_eval);
+        if (!is_tt_move_valid(pos, tt_best_move)) tt_best_move = 0;
     }
 
     // IIR: at non-PV nodes with no TT move, depth >= 4, reduce by 1
@@ -4527,8 +5343,8 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
         depth -= 1;
 
     // Save opponent's last move for countermove heuristic lookup/storage
-    int cm_piece = prev_move_piece;
-    int cm_to = prev_move_to;
+    int cm_piece = thread_ctx->prev_move_piece;
+    int cm_to = thread_ctx->prev_move_to;
 
     // v18: Singular extension — if the TT move is the only good move at this node, extend it.
     // Conditions: non-PV, depth>=8, have a TT move, not in check, not at root,
@@ -4537,13 +5353,13 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
     if (!pv_node && depth >= 8 && tt_best_move && !in_check && ply > 0
         && !se_excluded_move) {
         int se_tt_score, se_tt_flag, se_tt_depth;
-        if (get_tt_info(&se_tt_score, &se_tt_flag, &se_tt_depth)
+        if (get_tt_info(pos, &se_tt_score, &se_tt_flag, &se_tt_depth)
             && se_tt_depth >= depth - 3
             && (se_tt_flag == HASH_FLAG_EXACT || se_tt_flag == HASH_FLAG_BETA)
             && se_tt_score > -mate_score && se_tt_score < mate_score) {
             int se_beta = se_tt_score - 8 * depth;
             se_excluded_move = tt_best_move;
-            int se_score = negamax(se_beta - 1, se_beta, depth / 2, 0);
+            int se_score = negamax(pos, se_beta - 1, se_beta, depth / 2, 0);
             se_excluded_move = 0;
             if (!v14_stopped && se_score < se_beta - 50)
                 se_extension = 2;  // double extension: position is clearly singular
@@ -4560,29 +5376,28 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
     // v18: Try TT move first before generating all moves (saves generate_moves on TT cutoffs)
     // Skip if this move is excluded (we are inside the SE verification search for it).
     if (tt_best_move && tt_best_move != se_excluded_move) {
-        copy_board();
         ply++;
-        repetition_index++;
-        repetition_table[repetition_index] = hash_key;
-        prev_move_piece = get_move_piece(tt_best_move);
-        prev_move_to    = get_move_target(tt_best_move);
+        pos->repetition_index++;
+        pos->repetition_table[pos->repetition_index] = pos->hash_key;
+        thread_ctx->prev_move_piece = get_move_piece(tt_best_move);
+        thread_ctx->prev_move_to    = get_move_target(tt_best_move);
 
-        if (make_move(tt_best_move, all_moves)) {
+        if (make_move(pos, tt_best_move, all_moves)) {
             legal_moves_count = 1;
             int futile_tt = futile &&
                             !get_move_capture(tt_best_move) && !get_move_promoted(tt_best_move);
                 int tt_score;
             if (!futile_tt) {
-                tt_score = -negamax(-beta, -alpha, depth - 1 + se_extension, 1);
+                tt_score = -negamax(pos, -beta, -alpha, depth - 1 + se_extension, 1);
             } else {
                 tt_score = alpha;  // skip futile TT quiet moves too
             }
 
             ply--;
-            repetition_index--;
-            take_back();
+            pos->repetition_index--;
+            unmake_move(pos);
 
-            if (v14_stopped) { prev_move_piece = cm_piece; prev_move_to = cm_to; return 0; }
+            if (v14_stopped) { thread_ctx->prev_move_piece = cm_piece; thread_ctx->prev_move_to = cm_to; return 0; }
 
             if (tt_score > best_score) {
                 best_score = tt_score;
@@ -4594,71 +5409,72 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
                 int is_tt_cap = get_move_capture(tt_best_move);
                 if (!is_tt_cap) {
                     int bonus = depth * depth;
-                    history_moves[get_move_piece(tt_best_move)][get_move_target(tt_best_move)] +=
-                        bonus - history_moves[get_move_piece(tt_best_move)][get_move_target(tt_best_move)] * bonus / 16384;
+                    thread_ctx->history_moves[get_move_piece(tt_best_move)][get_move_target(tt_best_move)] +=
+                        bonus - thread_ctx->history_moves[get_move_piece(tt_best_move)][get_move_target(tt_best_move)] * bonus / 16384;
                 }
-                pv_table[ply][ply] = tt_best_move;
-                for (int np = ply + 1; np < pv_length[ply + 1]; np++)
-                    pv_table[ply][np] = pv_table[ply + 1][np];
-                pv_length[ply] = pv_length[ply + 1];
+                thread_ctx->pv_table[ply][ply] = tt_best_move;
+                for (int np = ply + 1; np < thread_ctx->pv_length[ply + 1]; np++)
+                    thread_ctx->pv_table[ply][np] = thread_ctx->pv_table[ply + 1][np];
+                thread_ctx->pv_length[ply] = thread_ctx->pv_length[ply + 1];
 
                 if (tt_score >= beta) {
-                    write_hash_entry(beta, depth, HASH_FLAG_BETA, tt_best_move);
+                    write_hash_entry(pos, beta, depth, HASH_FLAG_BETA, tt_best_move, node_eval);
                     if (!is_tt_cap) {
-                        if (tt_best_move != killer_moves[0][ply]) {
-                            killer_moves[1][ply] = killer_moves[0][ply];
-                            killer_moves[0][ply] = tt_best_move;
+                        if (tt_best_move != thread_ctx->killer_moves[0][ply]) {
+                            thread_ctx->killer_moves[1][ply] = thread_ctx->killer_moves[0][ply];
+                            thread_ctx->killer_moves[0][ply] = tt_best_move;
                         }
-                        if (cm_piece) countermove[cm_piece][cm_to] = tt_best_move;
+                        if (cm_piece) thread_ctx->countermove[cm_piece][cm_to] = tt_best_move;
                         if (cm_piece) {
                             int cb = depth * depth;
-                            short *ch = &cont_hist[cm_piece][cm_to][get_move_piece(tt_best_move)][get_move_target(tt_best_move)];
+                            short *ch = &thread_ctx->cont_hist[cm_piece][cm_to][get_move_piece(tt_best_move)][get_move_target(tt_best_move)];
                             int cv = (int)*ch + cb - (int)*ch * cb / 16384;
                             *ch = (short)(cv > 32767 ? 32767 : (cv < -32768 ? -32768 : cv));
                         }
                     }
-                    prev_move_piece = cm_piece;
-                    prev_move_to    = cm_to;
+                    thread_ctx->prev_move_piece = cm_piece;
+                    thread_ctx->prev_move_to    = cm_to;
                     return beta;
                 }
             }
         } else {
             ply--;
-            repetition_index--;
+            pos->repetition_index--;
         }
-        prev_move_piece = cm_piece;
-        prev_move_to    = cm_to;
+        thread_ctx->prev_move_piece = cm_piece;
+        thread_ctx->prev_move_to    = cm_to;
     }
 
-    // Generate and sort remaining moves (lazy: score upfront, pick-best per iteration)
-    moves move_list[1];
-    generate_moves(move_list);
-    int move_scores[256];
-    score_moves(move_list, move_scores, tt_best_move);
+    // v2.4: remaining moves come from the staged picker (captures, killers,
+    // countermove, quiets, losing captures)
+    move_picker picker[1];
+    init_move_picker(picker, tt_best_move);
 
     // v19: LMP threshold — quiet moves tried before pruning (indexed by depth)
     static const int lmp_threshold[4] = {0, 5, 10, 18};
     int quiets_tried = 0;
 
-    for (int count = 0; count < move_list->count; count++) {
-        pick_best_move(move_list, move_scores, count);
-        int move = move_list->moves[count];
-        if (move == tt_best_move) continue;       // already tried in pre-try stage
-        if (move == se_excluded_move) continue;   // excluded from SE verification search
+    // v2.4: ABDADA — moves another thread is searching are deferred and revisited
+    // once the picker is exhausted
+    int abdada = (num_threads > 1 && depth >= ABDADA_MIN_DEPTH);
+    int deferred[256];
+    int deferred_count = 0, deferred_index = 0;
+
+    for (;;) {
+        int is_deferred = 0;
+        int move = next_move(pos, picker);
+        if (!move) {
+            if (deferred_index == deferred_count) break;
+            move = deferred[deferred_index++];
+            is_deferred = 1;
+        } else if (move == se_excluded_move) {
+            continue;   // excluded from SE verification search
+        }
         int is_capture = get_move_capture(move);
         int is_promotion = get_move_promoted(move);
 
-        // v18: Find captured piece for capture_history (must be before copy_board)
-        int captured_piece_idx = -1;
-        if (is_capture) {
-            int sp2 = (side == white) ? p : P;
-            int ep2 = (side == white) ? k : K;
-            for (int bpc = sp2; bpc <= ep2; bpc++) {
-                if (get_bit(bitboards[bpc], get_move_target(move))) {
-                    captured_piece_idx = bpc; break;
-                }
-            }
-        }
+        // v18: Find captured piece for capture_history (must be before make_move)
+        int captured_piece_idx = is_capture ? pos->board[get_move_target(move)] : NO_PIECE;
 
         // Futility pruning: skip quiet moves in futile positions
         if (futile && legal_moves_count > 0 && !is_capture && !is_promotion)
@@ -4671,35 +5487,38 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
 
         // v2.2: History-based quiet pruning — skip clearly bad quiet moves at low depth
         if (!pv_node && !in_check && depth <= 3 && !is_capture && !is_promotion
-            && move != killer_moves[0][ply] && move != killer_moves[1][ply]
-            && history_moves[get_move_piece(move)][get_move_target(move)] < -2048 * depth)
+            && move != thread_ctx->killer_moves[0][ply] && move != thread_ctx->killer_moves[1][ply]
+            && thread_ctx->history_moves[get_move_piece(move)][get_move_target(move)] < -2048 * depth)
             continue;
 
-        copy_board();
-        ply++;
-        repetition_index++;
-        repetition_table[repetition_index] = hash_key;
-
-        if (make_move(move, all_moves) == 0) {
-            ply--;
-            repetition_index--;
+        // Leave moves that are already being searched elsewhere for last
+        U64 abdada_move_key = abdada ? abdada_key(pos, move) : 0;
+        if (abdada && !is_deferred && legal_moves_count > 0 && abdada_busy(abdada_move_key)) {
+            deferred[deferred_count++] = move;
             continue;
         }
 
+        ply++;
+        pos->repetition_index++;
+        pos->repetition_table[pos->repetition_index] = pos->hash_key;
+
+        make_move(pos, move, legal_moves);
+
+        if (abdada) abdada_mark(abdada_move_key);
         legal_moves_count++;
         // v19: Track quiet moves for LMP
         if (!is_capture && !is_promotion) quiets_tried++;
 
         // Tell recursive call what our move was (for countermove lookup at depth-1)
-        prev_move_piece = get_move_piece(move);
-        prev_move_to = get_move_target(move);
+        thread_ctx->prev_move_piece = get_move_piece(move);
+        thread_ctx->prev_move_to = get_move_target(move);
 
         int score;
 
         // PVS with LMR
         if (legal_moves_count == 1) {
             // First move: full window search
-            score = -negamax(-beta, -alpha, depth - 1, 1);
+            score = -negamax(pos, -beta, -alpha, depth - 1, 1);
         } else {
             // LMR: reduce depth for late quiet moves
             int reduction = 0;
@@ -4709,28 +5528,29 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
                 // v2.2: Reduce more when not improving (eval stagnating)
                 reduction += !improving;
                 // v19: History-adjusted LMR — reduce less for moves with strong history score
-                int hist = history_moves[get_move_piece(move)][get_move_target(move)];
+                int hist = thread_ctx->history_moves[get_move_piece(move)][get_move_target(move)];
                 reduction -= hist / 8192;
                 // v2.2: Continuation history adjustment in LMR
                 if (cm_piece)
-                    reduction -= cont_hist[cm_piece][cm_to][get_move_piece(move)][get_move_target(move)] / 16384;
+                    reduction -= thread_ctx->cont_hist[cm_piece][cm_to][get_move_piece(move)][get_move_target(move)] / 16384;
                 if (reduction < 0) reduction = 0;
                 if (reduction > depth - 2) reduction = depth - 2;
                 // Don't reduce if move gives check
-                if (is_in_check()) reduction = 0;
+                if (is_in_check(pos)) reduction = 0;
             }
 
             // Null window search with reduction
-            score = -negamax(-alpha - 1, -alpha, depth - 1 - reduction, 1);
+            score = -negamax(pos, -alpha - 1, -alpha, depth - 1 - reduction, 1);
 
             // Re-search if it beats alpha
             if (!v14_stopped && score > alpha && (reduction > 0 || score < beta))
-                score = -negamax(-beta, -alpha, depth - 1, 1);
+                score = -negamax(pos, -beta, -alpha, depth - 1, 1);
         }
 
         ply--;
-        repetition_index--;
-        take_back();
+        pos->repetition_index--;
+        unmake_move(pos);
+        if (abdada) abdada_unmark(abdada_move_key);
 
         if (v14_stopped) return 0;
 
@@ -4745,41 +5565,41 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
                 // Store history for quiet moves (with gravity scaling)
                 if (!is_capture) {
                     int bonus = depth * depth;
-                    history_moves[get_move_piece(move)][get_move_target(move)] +=
-                        bonus - history_moves[get_move_piece(move)][get_move_target(move)] * bonus / 16384;
+                    thread_ctx->history_moves[get_move_piece(move)][get_move_target(move)] +=
+                        bonus - thread_ctx->history_moves[get_move_piece(move)][get_move_target(move)] * bonus / 16384;
                 }
 
                 // Write PV
-                pv_table[ply][ply] = move;
-                for (int next_ply = ply + 1; next_ply < pv_length[ply + 1]; next_ply++)
-                    pv_table[ply][next_ply] = pv_table[ply + 1][next_ply];
-                pv_length[ply] = pv_length[ply + 1];
+                thread_ctx->pv_table[ply][ply] = move;
+                for (int next_ply = ply + 1; next_ply < thread_ctx->pv_length[ply + 1]; next_ply++)
+                    thread_ctx->pv_table[ply][next_ply] = thread_ctx->pv_table[ply + 1][next_ply];
+                thread_ctx->pv_length[ply] = thread_ctx->pv_length[ply + 1];
 
                 if (score >= beta) {
                     // Store TT entry
-                    write_hash_entry(beta, depth, HASH_FLAG_BETA, best_move);
+                    write_hash_entry(pos, beta, depth, HASH_FLAG_BETA, best_move, node_eval);
 
                     if (!is_capture) {
                         // Killer moves
-                        if (move != killer_moves[0][ply]) {
-                            killer_moves[1][ply] = killer_moves[0][ply];
-                            killer_moves[0][ply] = move;
+                        if (move != thread_ctx->killer_moves[0][ply]) {
+                            thread_ctx->killer_moves[1][ply] = thread_ctx->killer_moves[0][ply];
+                            thread_ctx->killer_moves[0][ply] = move;
                         }
                         // Countermove heuristic
                         if (cm_piece)
-                            countermove[cm_piece][cm_to] = move;
+                            thread_ctx->countermove[cm_piece][cm_to] = move;
                         // v18: Continuation history update
                         if (cm_piece) {
                             int ch_bonus = depth * depth;
-                            short *ch = &cont_hist[cm_piece][cm_to][get_move_piece(move)][get_move_target(move)];
+                            short *ch = &thread_ctx->cont_hist[cm_piece][cm_to][get_move_piece(move)][get_move_target(move)];
                             int ch_val = (int)*ch + ch_bonus - (int)*ch * ch_bonus / 16384;
                             *ch = (short)(ch_val >  32767 ?  32767 : (ch_val < -32768 ? -32768 : ch_val));
                         }
                     } else {
                         // v18: Capture history update on cutoff
-                        if (captured_piece_idx >= 0) {
+                        if (captured_piece_idx != NO_PIECE) {
                             int ch_bonus = depth * depth;
-                            int *ch = &capture_history[get_move_piece(move)][get_move_target(move)][captured_piece_idx];
+                            int *ch = &thread_ctx->capture_history[get_move_piece(move)][get_move_target(move)][captured_piece_idx];
                             *ch += ch_bonus - *ch * ch_bonus / 16384;
                         }
                     }
@@ -4792,7 +5612,7 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
         // History malus: penalize quiet moves that fail to improve alpha
         if (!is_capture && !is_promotion && score <= alpha) {
             int malus = depth * depth / 2;
-            int *h = &history_moves[get_move_piece(move)][get_move_target(move)];
+            int *h = &thread_ctx->history_moves[get_move_piece(move)][get_move_target(move)];
             *h -= malus + *h * malus / 16384;
         }
     }
@@ -4806,7 +5626,7 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
     }
 
     // Store TT entry
-    write_hash_entry(alpha, depth, hash_flag, best_move);
+    write_hash_entry(pos, alpha, depth, hash_flag, best_move, node_eval);
 
 #ifndef TUNER
     // Correction history update: adjust table based on error between search result and raw eval
@@ -4817,7 +5637,7 @@ static inline int negamax(int alpha, int beta, int depth, int null_ok)
         if (error < -CORR_MAX) error = -CORR_MAX;
         int weight = depth + 1;
         if (weight > 16) weight = 16;
-        int *entry = &corr_hist[hash_key & CORR_MASK];
+        int *entry = &corr_hist[pos->hash_key & CORR_MASK];
         *entry = (*entry * (CORR_GRAIN - weight) + error * weight) / CORR_GRAIN;
         if (*entry >  CORR_MAX) *entry =  CORR_MAX;
         if (*entry < -CORR_MAX) *entry = -CORR_MAX;
@@ -4869,112 +5689,438 @@ static int allocate_time(int my_time_ms, int my_inc_ms, int move_number, int the
     return budget;
 }
 
-// Save main-thread board state into master snapshot for worker threads
-static void save_board_to_master(void) {
-    memcpy(master_bitboards, bitboards, sizeof(bitboards));
-    memcpy(master_occupancies, occupancies, sizeof(occupancies));
-    master_side = side;
-    master_enpassant = enpassant;
-    master_castle = castle;
-    master_hash_key = hash_key;
-    memcpy(master_repetition_table, repetition_table, sizeof(repetition_table));
-    master_repetition_index = repetition_index;
-    master_ply = ply;
-    memcpy(master_has_castled, has_castled, sizeof(has_castled));
-    master_fullmove_number = fullmove_number;
-    master_halfmove_clock = halfmove_clock;
-}
-
-// Copy master board state into the calling thread's TLS board state
-static void copy_master_to_thread(void) {
-    memcpy(bitboards, master_bitboards, sizeof(bitboards));
-    memcpy(occupancies, master_occupancies, sizeof(occupancies));
-    side = master_side;
-    enpassant = master_enpassant;
-    castle = master_castle;
-    hash_key = master_hash_key;
-    memcpy(repetition_table, master_repetition_table, sizeof(repetition_table));
-    repetition_index = master_repetition_index;
-    ply = master_ply;
-    memcpy(has_castled, master_has_castled, sizeof(has_castled));
-    fullmove_number = master_fullmove_number;
-    halfmove_clock = master_halfmove_clock;
+// All-thread totals of the last completed search, reported by "stats"
+static cache_stats last_search_stats;
+
+static void add_cache_stats(cache_stats *into, const cache_stats *from)
+{
+    into->tt_probes     += from->tt_probes;
+    into->tt_hits       += from->tt_hits;
+    into->tt_collisions += from->tt_collisions;
+    into->eval_probes   += from->eval_probes;
+    into->eval_hits     += from->eval_hits;
+    into->pawn_probes   += from->pawn_probes;
+    into->pawn_hits     += from->pawn_hits;
 }
 
-typedef struct {
-    int thread_id;
-    int max_depth;
-} WorkerArgs;
+static double stats_pct(U64 count, U64 total)
+{
+    return total ? 100.0 * (double)count / (double)total : 0.0;
+}
 
-static void* worker_thread(void* arg) {
-    WorkerArgs* args = (WorkerArgs*)arg;
+// One-line summary as a UCI "info string"
+static void print_cache_stats(const cache_stats *st)
+{
+    printf("info string tt hit %.1f%% collisions %.3f%% evalcache hit %.1f%% pawn hit %.1f%%\n",
+           stats_pct(st->tt_hits, st->tt_probes),
+           stats_pct(st->tt_collisions, st->tt_hits),
+           stats_pct(st->eval_hits, st->eval_probes),
+           stats_pct(st->pawn_hits, st->pawn_probes));
+}
 
-    // Initialize this thread's board state from master
-    copy_master_to_thread();
+// One helper search: runs on a pool thread for every "go"
+static void worker_search(WorkerContext *ctx) {
+    position *pos = &ctx->pos;
 
     // Per-thread search state reset
+    thread_ctx = ctx;
+    ply = 0;
     nodes = 0;
     tb_hits = 0;
-    prev_move_piece = 0;
-    prev_move_to = 0;
+    my_counters = &counter_slots[ctx->thread_id];
+    memset(&search_stats, 0, sizeof(search_stats));
+    clear_search_context(ctx);
     se_excluded_move = 0;
-    memset(static_evals_by_ply, 0, sizeof(static_evals_by_ply));
-    memset(pv_table, 0, sizeof(pv_table));
-    memset(pv_length, 0, sizeof(pv_length));
 
-    int game_phase = get_game_phase();
+    int game_phase = get_game_phase(pos);
 
-    // Stagger starting depth by thread_id so threads explore different subtrees
-    for (int current_depth = 1 + args->thread_id;
-         current_depth <= args->max_depth && !stopped && !v14_stopped;
+    // v2.4: Depth-skip schedule. Helper i skips iterations by its row of
+    // skip_size / skip_phase, so at any moment the helpers spread over several
+    // depths around the main thread instead of all re-searching the same one.
+    static const int skip_size[20]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+    static const int skip_phase[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+    int row = (ctx->thread_id - 1) % 20;
+
+    for (int current_depth = 1;
+         current_depth <= ctx->max_depth && !stopped && !v14_stopped;
          current_depth++) {
+        if ((current_depth + skip_phase[row]) / skip_size[row] % 2)
+            continue;
         int search_depth = (game_phase < PHASE_THRESHOLD) ? current_depth + 1 : current_depth;
-        negamax(-infinity, infinity, search_depth, 1);
+        int score = negamax(pos, -infinity, infinity, search_depth, 1);
+
+        // Publish completed iterations only; read by the main thread after the pool parks
+        if (stopped || v14_stopped) break;
+        if (thread_ctx->pv_table[0][0])
+            save_search_result(&ctx->result, current_depth, score);
+    }
+
+    ctx->stats = search_stats;
+    publish_counters();
+}
+
+// v2.4: Persistent Lazy SMP helper pool. Helpers are created once (startup and
+// "setoption name Threads") and park on pool_wake between searches. Each search
+// copies the root position into every helper's context and bumps pool_search_id;
+// the helpers search their copy until stopped, then report idle.
+static WorkerContext *pool_ctx = NULL;  // [0] main search thread, [1..pool_helpers] helpers
+static int pool_helpers = 0;            // helper threads running
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;  // new search or quit
+static pthread_cond_t pool_idle = PTHREAD_COND_INITIALIZER;  // last busy helper finished
+static unsigned pool_search_id = 0;
+static int pool_max_depth = 0;
+static int pool_busy = 0;     // helpers still searching the current root
+static int pool_quit = 0;
+
+static void *pool_thread(void *arg) {
+    WorkerContext *ctx = (WorkerContext *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool_mutex);
+        while (!pool_quit && ctx->search_id == pool_search_id)
+            pthread_cond_wait(&pool_wake, &pool_mutex);
+        if (pool_quit) {
+            pthread_mutex_unlock(&pool_mutex);
+            return NULL;
+        }
+        ctx->search_id = pool_search_id;
+        ctx->max_depth = pool_max_depth;
+        pthread_mutex_unlock(&pool_mutex);
+
+        worker_search(ctx);
+
+        pthread_mutex_lock(&pool_mutex);
+        if (--pool_busy == 0)
+            pthread_cond_signal(&pool_idle);
+        pthread_mutex_unlock(&pool_mutex);
+    }
+}
+
+// Wake every helper on its own copy of the root
+static void pool_start_search(position *root, int max_depth) {
+    pthread_mutex_lock(&pool_mutex);
+    for (int i = 1; i <= pool_helpers; i++)
+        pool_ctx[i].pos = *root;
+    pool_max_depth = max_depth;
+    pool_busy = pool_helpers;
+    pool_search_id++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+// Sum the published counters of the main search thread and every helper
+static void search_totals(U64 *total_nodes, U64 *total_tb_hits) {
+    publish_counters();
+    *total_nodes = *total_tb_hits = 0;
+    for (int i = 0; i <= pool_helpers; i++) {
+        *total_nodes   += __atomic_load_n(&counter_slots[i].nodes, __ATOMIC_RELAXED);
+        *total_tb_hits += __atomic_load_n(&counter_slots[i].tb_hits, __ATOMIC_RELAXED);
+    }
+}
+
+// UCI "info" line for a completed iteration; nodes and tbhits are totals over all
+// search threads (caller holds the stdout lock)
+static void print_search_info(int depth, int score, const int *pv, int pv_length)
+{
+    long elapsed = get_time_ms() - v14_search_start;
+    if (elapsed < 1) elapsed = 1;
+
+    // Nodes and tbhits of all threads
+    U64 all_nodes, all_tb_hits;
+    search_totals(&all_nodes, &all_tb_hits);
+    U64 nps = all_nodes * 1000 / elapsed;
+
+    if (score > -mate_value && score < -mate_score)
+        printf("info score mate %d depth %d nodes %llu nps %llu time %ld hashfull %d tbhits %llu pv ",
+               -(score + mate_value) / 2 - 1, depth, all_nodes, nps, elapsed, tt_hashfull(), all_tb_hits);
+    else if (score > mate_score && score < mate_value)
+        printf("info score mate %d depth %d nodes %llu nps %llu time %ld hashfull %d tbhits %llu pv ",
+               (mate_value - score) / 2 + 1, depth, all_nodes, nps, elapsed, tt_hashfull(), all_tb_hits);
+    else
+        printf("info score cp %d depth %d nodes %llu nps %llu time %ld hashfull %d tbhits %llu pv ",
+               score, depth, all_nodes, nps, elapsed, tt_hashfull(), all_tb_hits);
+
+    for (int i = 0; i < pv_length; i++) {
+        print_move(pv[i]);
+        printf(" ");
+    }
+    printf("\n");
+}
+
+// v2.4: Lazy SMP best-move voting. Each thread with a completed iteration votes
+// for its root move with weight (score - worst score + 14) * depth, so moves found
+// by deeper or more optimistic threads win. A proven mate beats the vote.
+// Only call once the pool has parked; returns the chosen thread's result.
+static const search_result *vote_best_move(void) {
+    const search_result *main_result = &pool_ctx[0].result;
+    const search_result *best = main_result;
+    if (pool_helpers == 0 || !main_result->move) return best;
+
+    #define VOTER(i) (&pool_ctx[i].result)
+    int worst_score = main_result->score;
+    for (int i = 1; i <= pool_helpers; i++)
+        if (VOTER(i)->depth && VOTER(i)->score < worst_score)
+            worst_score = VOTER(i)->score;
+
+    long best_votes = -1;
+    for (int i = 0; i <= pool_helpers; i++) {
+        const search_result *r = VOTER(i);
+        if (!r->depth || !r->move) continue;
+
+        long votes = 0;
+        for (int j = 0; j <= pool_helpers; j++)
+            if (VOTER(j)->depth && VOTER(j)->move == r->move)
+                votes += (long)(VOTER(j)->score - worst_score + 14) * VOTER(j)->depth;
+
+        if (best->score > mate_score) {
+            // Already holding a mate: only a faster mate replaces it
+            if (r->score > best->score) best = r;
+        } else if (r->score > mate_score || votes > best_votes ||
+                   (votes == best_votes && r->depth > best->depth)) {
+            best = r;
+            best_votes = votes;
+        }
+    }
+    #undef VOTER
+    return best;
+}
+
+// Block until every helper has left the current search (caller sets stopped first)
+static void pool_wait_search(void) {
+    pthread_mutex_lock(&pool_mutex);
+    while (pool_busy > 0)
+        pthread_cond_wait(&pool_idle, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+// (Re)build the pool with threads - 1 helpers. Only call while no search is running.
+void thread_pool_init(int threads) {
+    pthread_mutex_lock(&pool_mutex);
+    pool_quit = 1;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_mutex);
+    for (int i = 1; i <= pool_helpers; i++)
+        pthread_join(pool_ctx[i].thread, NULL);
+    free(pool_ctx);
+    pool_ctx = NULL;
+    pool_helpers = 0;
+    pool_quit = 0;
+
+    if (threads > max_threads) threads = max_threads;
+    pool_ctx = (WorkerContext *)calloc(threads, sizeof(WorkerContext));
+    if (!pool_ctx) {
+        fprintf(stderr, "Cannot allocate search thread contexts\n");
+        exit(1);
+    }
+    for (int i = 1; i < threads; i++) {
+        pool_ctx[i].thread_id = i;
+        pool_ctx[i].search_id = pool_search_id;
+        if (pthread_create(&pool_ctx[i].thread, NULL, pool_thread, &pool_ctx[i]) != 0)
+            break;
+        pool_helpers = i;
+    }
+    num_threads = pool_helpers + 1;
+}
+
+// v2.4: UCI input thread. A dedicated thread reads stdin line by line so the engine
+// keeps listening while it searches. "stop", "ponderhit", "isready" and "quit"
+// act immediately during a search; everything else (position, go, setoption, ...)
+// goes into a FIFO that uci_loop() drains on the main thread. While idle, the
+// urgent commands are queued too so they keep their order relative to the rest;
+// any still queued when the next search starts are applied by input_search_started().
+#define UCI_LINE_LEN 16384
+#define CMD_QUEUE_SIZE 32
+
+static char cmd_queue[CMD_QUEUE_SIZE][UCI_LINE_LEN];
+static int cmd_head = 0;   // next command to hand out
+static int cmd_count = 0;  // commands waiting
+static int searching = 0;  // a search is running (guarded by cmd_mutex)
+static pthread_mutex_t cmd_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cmd_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t cmd_space = PTHREAD_COND_INITIALIZER;
+
+// Ponderhit budget, computed from the "go ponder ..." command on the main thread
+static int ponderhit_budget_ms = 0;
+static int ponderhit_hard_ms = 0;
+
+// Stdout is shared with the input thread; multi-part lines are printed under this lock
+#ifdef WIN64
+    #define lock_stdout()   _lock_file(stdout)
+    #define unlock_stdout() _unlock_file(stdout)
+#else
+    #define lock_stdout()   flockfile(stdout)
+    #define unlock_stdout() funlockfile(stdout)
+#endif
+
+// Turn the running ponder search into a timed one whose budget runs from now; "info
+// time" and nps keep counting from the start of the ponder search (call with cmd_mutex held)
+static void apply_ponderhit(void)
+{
+    if (!is_pondering) return;
+    is_pondering = 0;
+    if (ponderhit_budget_ms > 0) {
+        long now = get_time_ms();
+        v14_hard_limit_ms = ponderhit_hard_ms;
+        __atomic_store_n(&v14_budget_start, now, __ATOMIC_RELAXED);
+        __atomic_store_n(&v14_time_budget_ms, ponderhit_budget_ms, __ATOMIC_RELEASE);
+        timer_arm(now, ponderhit_budget_ms, ponderhit_hard_ms);
+    }
+}
+
+static void print_readyok(void)
+{
+    printf("readyok\n");
+    fflush(stdout);
+}
+
+// Append a line to the queue, waiting for room if the main thread is behind
+static void enqueue_command(const char *line)
+{
+    while (cmd_count == CMD_QUEUE_SIZE)
+        pthread_cond_wait(&cmd_space, &cmd_mutex);
+    char *slot = cmd_queue[(cmd_head + cmd_count) % CMD_QUEUE_SIZE];
+    strncpy(slot, line, UCI_LINE_LEN - 1);
+    slot[UCI_LINE_LEN - 1] = '\0';
+    cmd_count++;
+    pthread_cond_signal(&cmd_ready);
+}
+
+// Take the next queued command (blocks until one arrives)
+static void dequeue_command(char *out)
+{
+    pthread_mutex_lock(&cmd_mutex);
+    while (cmd_count == 0)
+        pthread_cond_wait(&cmd_ready, &cmd_mutex);
+    strcpy(out, cmd_queue[cmd_head]);
+    cmd_head = (cmd_head + 1) % CMD_QUEUE_SIZE;
+    cmd_count--;
+    pthread_cond_signal(&cmd_space);
+    pthread_mutex_unlock(&cmd_mutex);
+}
+
+static void *input_thread_main(void *arg)
+{
+    (void)arg;
+    static char line[UCI_LINE_LEN];
+
+    while (fgets(line, sizeof(line), stdin)) {
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        if (line[0] == '\0') continue;
+
+        pthread_mutex_lock(&cmd_mutex);
+        if (!strncmp(line, "quit", 4)) {
+            quit = 1;
+            stopped = 1;
+            v14_stopped = 1;
+            enqueue_command(line);
+            pthread_mutex_unlock(&cmd_mutex);
+            return NULL;
+        }
+        if (searching && !strncmp(line, "stop", 4)) {
+            stopped = 1;
+            v14_stopped = 1;
+        } else if (searching && !strncmp(line, "ponderhit", 9)) {
+            apply_ponderhit();
+        } else if (searching && !strncmp(line, "isready", 7)) {
+            print_readyok();
+        } else {
+            enqueue_command(line);
+        }
+        pthread_mutex_unlock(&cmd_mutex);
     }
 
+    // EOF on stdin: shut down like "quit"
+    pthread_mutex_lock(&cmd_mutex);
+    quit = 1;
+    stopped = 1;
+    v14_stopped = 1;
+    enqueue_command("quit");
+    pthread_mutex_unlock(&cmd_mutex);
     return NULL;
 }
 
+// Called by search_position() once its stop flags and clock are reset: from here on
+// the input thread applies stop / ponderhit / isready directly. Urgent commands that
+// were queued before the search got going are applied now, out of queue order.
+static void input_search_started(void)
+{
+    pthread_mutex_lock(&cmd_mutex);
+    searching = 1;
+    int kept = 0;
+    for (int i = 0; i < cmd_count; i++) {
+        char *cmd = cmd_queue[(cmd_head + i) % CMD_QUEUE_SIZE];
+        if (!strncmp(cmd, "stop", 4)) {
+            stopped = 1;
+            v14_stopped = 1;
+        } else if (!strncmp(cmd, "ponderhit", 9)) {
+            apply_ponderhit();
+        } else if (!strncmp(cmd, "isready", 7)) {
+            print_readyok();
+        } else {
+            if (kept != i)
+                memmove(cmd_queue[(cmd_head + kept) % CMD_QUEUE_SIZE], cmd, strlen(cmd) + 1);
+            kept++;
+        }
+    }
+    cmd_count = kept;
+    if (quit) {
+        stopped = 1;
+        v14_stopped = 1;
+    }
+    pthread_mutex_unlock(&cmd_mutex);
+}
+
+static void input_search_finished(void)
+{
+    pthread_mutex_lock(&cmd_mutex);
+    searching = 0;
+    pthread_mutex_unlock(&cmd_mutex);
+}
+
 // Search position: iterative deepening with aspiration windows
-void search_position(int max_depth, int time_budget_ms)
+void search_position(position *pos, int max_depth, int time_budget_ms)
 {
-    // Reset
+    // A pending "ucinewgame" clear must finish before probing (and before the clock starts)
+    tt_clear_wait();
+
+    // Reset (disarm first so a previous search's deadline cannot fire after the reset)
+    timer_disarm();
     nodes = 0;
     tb_hits = 0;
+    memset(&search_stats, 0, sizeof(search_stats));
     v14_stopped = 0;
     stopped = 0;
     v14_search_start = get_time_ms();
+    v14_budget_start = v14_search_start;
     v14_time_budget_ms = time_budget_ms;
+    timer_arm(v14_budget_start, time_budget_ms, v14_hard_limit_ms);
+    input_search_started();
+    tt_generation++;  // new search: age every entry already in the TT
 
-    memset(killer_moves, 0, sizeof(killer_moves));
-    memset(history_moves, 0, sizeof(history_moves));
-    memset(countermove, 0, sizeof(countermove));
-    memset(capture_history, 0, sizeof(capture_history));
-    memset(cont_hist, 0, sizeof(cont_hist));
-    memset(pv_table, 0, sizeof(pv_table));
-    memset(pv_length, 0, sizeof(pv_length));
-    prev_move_piece = 0;
-    prev_move_to = 0;
+    thread_ctx = &pool_ctx[0];
+    clear_search_context(thread_ctx);
     se_excluded_move = 0;
-    memset(static_evals_by_ply, 0, sizeof(static_evals_by_ply));
 
 #ifndef TUNER
     // Root TB probe: instantly play the DTZ-optimal move for positions covered by tablebases.
     // Only when not pondering — ponder thread must not output bestmove early (ponder-early-finish bug).
     if (!is_pondering && TB_LARGEST > 0 &&
-        count_bits(occupancies[both]) <= (int)TB_LARGEST) {
+        count_bits(pos->occupancies[both]) <= (int)TB_LARGEST) {
         unsigned results[TB_MAX_MOVES];
-        unsigned ep_sq = (enpassant != no_sq) ? (enpassant ^ 56) : 0;
+        unsigned ep_sq = (pos->enpassant != no_sq) ? (pos->enpassant ^ 56) : 0;
         unsigned tb_result = tb_probe_root_impl(
-            __builtin_bswap64(occupancies[white]),
-            __builtin_bswap64(occupancies[black]),
-            __builtin_bswap64(bitboards[K] | bitboards[k]),
-            __builtin_bswap64(bitboards[Q] | bitboards[q]),
-            __builtin_bswap64(bitboards[R] | bitboards[r]),
-            __builtin_bswap64(bitboards[B] | bitboards[b]),
-            __builtin_bswap64(bitboards[N] | bitboards[n]),
-            __builtin_bswap64(bitboards[P] | bitboards[p]),
-            halfmove_clock, ep_sq, (side == white), results
+            __builtin_bswap64(pos->occupancies[white]),
+            __builtin_bswap64(pos->occupancies[black]),
+            __builtin_bswap64(pos->bitboards[K] | pos->bitboards[k]),
+            __builtin_bswap64(pos->bitboards[Q] | pos->bitboards[q]),
+            __builtin_bswap64(pos->bitboards[R] | pos->bitboards[r]),
+            __builtin_bswap64(pos->bitboards[B] | pos->bitboards[b]),
+            __builtin_bswap64(pos->bitboards[N] | pos->bitboards[n]),
+            __builtin_bswap64(pos->bitboards[P] | pos->bitboards[p]),
+            pos->halfmove_clock, ep_sq, (pos->side == white), results
         );
         if (tb_result != TB_RESULT_FAILED &&
             tb_result != TB_RESULT_CHECKMATE &&
@@ -4985,7 +6131,7 @@ void search_position(int max_depth, int time_budget_ms)
             unsigned to_sq    = TB_GET_TO(tb_result)   ^ 56;
             unsigned promotes = TB_GET_PROMOTES(tb_result);
             moves move_list[1];
-            generate_moves(move_list);
+            generate_moves(pos, move_list);
             int tb_move = 0;
             for (int i = 0; i < move_list->count; i++) {
                 int m = move_list->moves[i];
@@ -4993,7 +6139,7 @@ void search_position(int max_depth, int time_budget_ms)
                     (unsigned)get_move_target(m) != to_sq) continue;
                 if (promotes != TB_PROMOTES_NONE) {
                     int pp = get_move_promoted(m);
-                    int want = (side == white)
+                    int want = (pos->side == white)
                         ? (int[]){0, Q, R, B, N}[promotes]
                         : (int[]){0, q, r, b, n}[promotes];
                     if (pp != want) continue;
@@ -5002,11 +6148,13 @@ void search_position(int max_depth, int time_budget_ms)
             }
             if (tb_move) {
                 unsigned dtz = TB_GET_DTZ(tb_result);
+                lock_stdout();
                 printf("info depth 0 score cp %d time 0 nodes 1 pv ",
                        mate_value - (int)dtz);
                 print_move(tb_move); printf("\n");
                 printf("bestmove "); print_move(tb_move); printf("\n");
                 fflush(stdout);
+                unlock_stdout();
                 return;
             }
         }
@@ -5017,39 +6165,26 @@ void search_position(int max_depth, int time_budget_ms)
     // Forced move: if only one legal move exists, play it instantly without searching.
     if (!is_pondering) {
         moves root_moves[1];
-        generate_moves(root_moves);
-        int legal_count = 0, only_move = 0;
-        for (int i = 0; i < root_moves->count && legal_count <= 1; i++) {
-            { // nested block required: copy_board() declares locals
-                copy_board();
-                if (make_move(root_moves->moves[i], all_moves)) {
-                    take_back();
-                    legal_count++;
-                    only_move = root_moves->moves[i];
-                }
-            }
-        }
-        if (legal_count == 1) {
+        generate_moves(pos, root_moves);
+        if (root_moves->count == 1) {
+            int only_move = root_moves->moves[0];
+            lock_stdout();
             printf("info depth 1 score cp 0 time 0 nodes 1 pv ");
             print_move(only_move);
             printf("\nbestmove ");
             print_move(only_move);
             printf("\n");
             fflush(stdout);
+            unlock_stdout();
             return;
         }
     }
 
-    // Save board state for worker threads and spawn them
-    pthread_t worker_threads[MAX_THREADS];
-    WorkerArgs worker_args[MAX_THREADS];
-    if (num_threads > 1) {
-        save_board_to_master();
-        for (int i = 1; i < num_threads; i++) {
-            worker_args[i].thread_id = i;
-            worker_args[i].max_depth = max_depth;
-            pthread_create(&worker_threads[i], NULL, worker_thread, &worker_args[i]);
-        }
+    // Save board state for the helper pool and wake it
+    my_counters = &counter_slots[0];
+    memset(counter_slots, 0, (pool_helpers + 1) * sizeof(thread_counters));
+    if (pool_helpers > 0) {
+        pool_start_search(pos, max_depth);
     }
 
     int score = 0;
@@ -5063,7 +6198,7 @@ void search_position(int max_depth, int time_budget_ms)
     int move_stability = 0;
     int prev_score = 0;
 
-    int game_phase = get_game_phase();
+    int game_phase = get_game_phase(pos);
 
     // Minimum depth based on time budget
     int min_depth;
@@ -5073,9 +6208,17 @@ void search_position(int max_depth, int time_budget_ms)
     else min_depth = 5;
 
     for (int current_depth = 1; current_depth <= max_depth; current_depth++) {
+        // v2.4: ponderhit turns the infinite ponder search into a timed one in place
+        if (time_budget_ms != v14_time_budget_ms) {
+            time_budget_ms = v14_time_budget_ms;
+            if (time_budget_ms < 2000) min_depth = 3;
+            else if (time_budget_ms < 5000) min_depth = 4;
+            else min_depth = 5;
+        }
+
         // Time check: don't start new depth if 55%+ of budget used
         if (time_budget_ms > 0 && current_depth > min_depth) {
-            long elapsed = get_time_ms() - v14_search_start;
+            long elapsed = get_time_ms() - v14_budget_start;
             if (elapsed > (long)(time_budget_ms * 0.55))
                 break;
         }
@@ -5089,20 +6232,20 @@ void search_position(int max_depth, int time_budget_ms)
         if (current_depth <= 2) {
             alpha = -infinity;
             beta = infinity;
-            score = negamax(alpha, beta, search_depth, 1);
+            score = negamax(pos, alpha, beta, search_depth, 1);
         } else {
             int asp_delta = 50;
             alpha = score - asp_delta;
             beta = score + asp_delta;
-            score = negamax(alpha, beta, search_depth, 1);
+            score = negamax(pos, alpha, beta, search_depth, 1);
 
             // Widen window gradually on failure
             while (!v14_stopped && (score <= alpha || score >= beta)) {
                 if (time_budget_ms > 0) {
-                    long elapsed = get_time_ms() - v14_search_start;
+                    long elapsed = get_time_ms() - v14_budget_start;
                     if (elapsed > (long)(time_budget_ms * 0.7)) {
-                        if (pv_length[0] > 0)
-                            best_move_found = pv_table[0][0];
+                        if (thread_ctx->pv_length[0] > 0)
+                            best_move_found = thread_ctx->pv_table[0][0];
                         goto done;
                     }
                 }
@@ -5110,7 +6253,7 @@ void search_position(int max_depth, int time_budget_ms)
                 else               beta  = score + asp_delta;
                 asp_delta *= 3;  // 50 -> 150 -> 450 -> full
                 if (asp_delta >= 900) { alpha = -infinity; beta = infinity; }
-                score = negamax(alpha, beta, search_depth, 1);
+                score = negamax(pos, alpha, beta, search_depth, 1);
             }
         }
 
@@ -5120,9 +6263,10 @@ void search_position(int max_depth, int time_budget_ms)
         // Use pv_table[0][0] directly (not pv_length[0]>0) because pv_length[0] can be
         // incorrectly left at 0 when v14_stopped fires in a child before pv_length[ply]=ply
         // executes (line 4085 check fires before line 4088 init).
-        if (pv_table[0][0]) {
-            best_move_found = pv_table[0][0];
-            best_ponder_move = (pv_length[0] >= 2 && pv_table[0][1]) ? pv_table[0][1] : 0;
+        if (thread_ctx->pv_table[0][0]) {
+            best_move_found = thread_ctx->pv_table[0][0];
+            best_ponder_move = (thread_ctx->pv_length[0] >= 2 && thread_ctx->pv_table[0][1]) ? thread_ctx->pv_table[0][1] : 0;
+            save_search_result(&thread_ctx->result, current_depth, score);
         }
 
         // v16: score instability / easy move detection
@@ -5139,31 +6283,17 @@ void search_position(int max_depth, int time_budget_ms)
             // Easy move: same best move for 3+ depths, small score swing, past 40% of budget
             if (current_depth > min_depth && time_budget_ms > 0
                 && move_stability >= 3 && score_swing < 30) {
-                long chk = get_time_ms() - v14_search_start;
+                long chk = get_time_ms() - v14_budget_start;
                 if (chk > (long)(time_budget_ms * 0.4)) break;
             }
         }
 
         // Print UCI info
-        long elapsed = get_time_ms() - v14_search_start;
-        if (elapsed < 1) elapsed = 1;
-
-        if (score > -mate_value && score < -mate_score)
-            printf("info score mate %d depth %d nodes %lld time %ld tbhits %llu pv ",
-                   -(score + mate_value) / 2 - 1, current_depth, nodes, elapsed, tb_hits);
-        else if (score > mate_score && score < mate_value)
-            printf("info score mate %d depth %d nodes %lld time %ld tbhits %llu pv ",
-                   (mate_value - score) / 2 + 1, current_depth, nodes, elapsed, tb_hits);
-        else
-            printf("info score cp %d depth %d nodes %lld time %ld tbhits %llu pv ",
-                   score, current_depth, nodes, elapsed, tb_hits);
-
-        for (int i = 0; i < pv_length[0]; i++) {
-            print_move(pv_table[0][i]);
-            printf(" ");
-        }
-        printf("\n");
+        lock_stdout();
+        print_search_info(current_depth, score, thread_ctx->pv_table[0], thread_ctx->pv_length[0]);
+        print_cache_stats(&search_stats);
         fflush(stdout);
+        unlock_stdout();
 
         // Stop if mate found
         if (score > mate_score || score < -mate_score)
@@ -5174,32 +6304,53 @@ void search_position(int max_depth, int time_budget_ms)
     }
 
 done:
-    // Stop and join worker threads
-    if (num_threads > 1) {
+    // Stop the helpers and wait for them to park. Their node loops only poll
+    // v14_stopped, so raise it as the deadline would; the timer stays armed until
+    // the pool has parked as a backstop.
+    if (pool_helpers > 0) {
         stopped = 1;  // ensure workers exit
-        for (int i = 1; i < num_threads; i++)
-            pthread_join(worker_threads[i], NULL);
+        v14_stopped = 1;
+        pool_wait_search();
+    }
+    timer_disarm();
+
+    last_search_stats = search_stats;
+    for (int i = 1; i <= pool_helpers; i++)
+        add_cache_stats(&last_search_stats, &pool_ctx[i].stats);
+
+    // Let the helpers vote; only a fully completed main iteration takes part.
+    // When a helper's result wins, report its line so the final info matches bestmove.
+    if (thread_ctx->result.move && thread_ctx->result.move == best_move_found) {
+        const search_result *voted = vote_best_move();
+        if (voted != &thread_ctx->result) {
+            lock_stdout();
+            print_search_info(voted->depth, voted->score, voted->pv, voted->pv_length);
+            fflush(stdout);
+            unlock_stdout();
+        }
+        best_move_found  = voted->move;
+        best_ponder_move = voted->ponder;
     }
 
     // Print best move. Prefer the saved cross-depth best move; fall back to
     // pv_table[0][0] (safe since it's memset'd to 0 at search start).
-    int bm = best_move_found ? best_move_found : pv_table[0][0];
+    int bm = best_move_found ? best_move_found : thread_ctx->pv_table[0][0];
 
     // Validate ponder move: temporarily apply bestmove and check legality.
     // This catches any case where the engine's board was wrong (wrong ponder position,
     // TT collision, etc.) and prevents python-chess from starting a ponder on a bad position.
     int validated_ponder = 0;
     if (bm && best_ponder_move) {
-        copy_board();
-        if (make_move(bm, all_moves)) {
+        if (make_move(pos, bm, all_moves)) {
             // Side has flipped — verify ponder belongs to the new side to move,
             // is on its source square, and doesn't capture an own piece.
-            if (is_tt_move_valid(best_ponder_move))
+            if (is_tt_move_valid(pos, best_ponder_move))
                 validated_ponder = best_ponder_move;
+            unmake_move(pos);
         }
-        take_back();
     }
 
+    lock_stdout();
     printf("bestmove ");
     if (bm) print_move(bm);
     else printf("0000");
@@ -5211,6 +6362,7 @@ done:
 
     printf("\n");
     fflush(stdout);
+    unlock_stdout();
 }
 
 
@@ -5223,10 +6375,10 @@ done:
 \**********************************/
 
 // Parse user/GUI move string input (e.g. "e7e8q")
-int parse_move(char *move_string)
+int parse_move(position *pos, char *move_string)
 {
     moves move_list[1];
-    generate_moves(move_list);
+    generate_moves(pos, move_list);
 
     int source_square = (move_string[0] - 'a') + (8 - (move_string[1] - '0')) * 8;
     int target_square = (move_string[2] - 'a') + (8 - (move_string[3] - '0')) * 8;
@@ -5253,20 +6405,20 @@ int parse_move(char *move_string)
 }
 
 // Parse UCI "position" command
-void parse_position(char *command)
+void parse_position(position *pos, char *command)
 {
     command += 9;
     char *current_char = command;
 
     if (strncmp(command, "startpos", 8) == 0)
-        parse_fen(start_position);
+        parse_fen(pos, start_position);
     else {
         current_char = strstr(command, "fen");
         if (current_char == NULL)
-            parse_fen(start_position);
+            parse_fen(pos, start_position);
         else {
             current_char += 4;
-            parse_fen(current_char);
+            parse_fen(pos, current_char);
         }
     }
 
@@ -5276,123 +6428,33 @@ void parse_position(char *command)
         current_char += 6;
 
         while (*current_char) {
-            int move = parse_move(current_char);
+            int move = parse_move(pos, current_char);
             if (move == 0) break;
 
-            repetition_index++;
-            repetition_table[repetition_index] = hash_key;
+            pos->repetition_index++;
+            pos->repetition_table[pos->repetition_index] = pos->hash_key;
 
-            if (!make_move(move, all_moves)) {
-                // make_move() called take_back() internally; board is restored.
+            if (!make_move(pos, move, all_moves)) {
+                // make_move() called unmake_move() internally; board is restored.
                 // This should never happen for valid game positions, but if it does,
                 // stop processing rather than silently continuing with the wrong board.
-                repetition_index--;
+                pos->repetition_index--;
                 break;
             }
 
+            // v2.4: game moves are never unmade, so don't let a long game fill the undo stack
+            pos->undo_count = 0;
+
             while (*current_char && *current_char != ' ') current_char++;
             current_char++;
         }
     }
 }
 
-// Thread function for ponder search — runs search_position() in background so the
-// UCI loop's main thread can keep reading stdin and detect stop/ponderhit.
-// Board state is TLS (__thread), so we must copy it from the master snapshot
-// (saved by the main thread before pthread_create) into this thread's TLS.
-static void *ponder_search_thread(void *arg)
+// Search depth and time budget for a "go" command (v13 time management).
+// Also sets v14_hard_limit_ms for clock-based searches. Returns 0 for no limit.
+static int go_time_budget(position *pos, char *command, int *search_depth)
 {
-    (void)arg;
-    copy_master_to_thread();  // populate this thread's TLS board from the main thread
-    search_position(30, 0);   // infinite search; prints bestmove when v14_stopped fires
-    return NULL;
-}
-
-// Parse UCI "go" command with v13's time management
-void parse_go(char *command)
-{
-    // "go ponder" = infinite search on opponent's time.
-    // Run in a background thread so the UCI loop can read "stop" or "ponderhit" from stdin.
-    // "go wtime X btime Y ponder" = normal timed search (fall through to time-control parsing).
-    if (strncmp(command, "go ponder", 9) == 0) {
-        is_pondering = 1;
-
-        // Snapshot the current board into master_* so ponder_search_thread can
-        // copy_master_to_thread() — all board state (bitboards, side, etc.) is __thread TLS.
-        save_board_to_master();
-
-        // Start ponder search in background
-        pthread_t ponder_th;
-        pthread_create(&ponder_th, NULL, ponder_search_thread, NULL);
-
-        // Read commands until we receive stop, ponderhit, or a position command.
-        //
-        // The normal cases are:
-        //   "stop"      — opponent played a different move (ponder miss)
-        //   "ponderhit" — opponent played the predicted move (ponder hit)
-        //
-        // Edge case: the ponder search can complete ALL depths naturally (e.g. finds
-        // forced mate in a simple endgame) and output bestmove BEFORE stop/ponderhit
-        // arrives.  python-chess sees the ponder bestmove, ends the ponder command
-        // without calling cancel(), and the new play() command's start() goes straight
-        // to sending "position fen... moves..." followed by "go wtime... btime...".
-        // If we naively read only one line here we would consume "position fen..." and
-        // discard it, then parse_go() would search from the stale ponder board —
-        // exactly the bug that caused the bot to play an illegal move (e5d6).
-        //
-        // We also handle "isready" gracefully in case the GUI sends it for sync.
-        char ponder_cmd[2000] = "";
-        while (fgets(ponder_cmd, sizeof(ponder_cmd), stdin)) {
-            char *nl = strchr(ponder_cmd, '\n');
-            if (nl) *nl = '\0';
-
-            if (!strncmp(ponder_cmd, "quit", 4)) {
-                quit = 1;
-                break;
-            } else if (!strncmp(ponder_cmd, "stop", 4) ||
-                       !strncmp(ponder_cmd, "ponderhit", 9)) {
-                // Normal stop or ponderhit — fall through to stop the ponder thread.
-                break;
-            } else if (!strncmp(ponder_cmd, "isready", 7)) {
-                printf("readyok\n");
-                fflush(stdout);
-                // Keep reading; the real stop/ponderhit/position is next.
-            } else if (!strncmp(ponder_cmd, "position", 8)) {
-                // Ponder search finished early (natural completion) and python-chess
-                // sent "position" directly without a prior "stop".  Stop the ponder
-                // thread, apply the actual game position, then read and execute the
-                // "go" command so the search uses the correct board.
-                v14_stopped = 1;
-                stopped = 1;
-                is_pondering = 0;
-                pthread_join(ponder_th, NULL);
-
-                parse_position(ponder_cmd);
-
-                char go_cmd[2000] = "";
-                while (fgets(go_cmd, sizeof(go_cmd), stdin)) {
-                    char *nl2 = strchr(go_cmd, '\n');
-                    if (nl2) *nl2 = '\0';
-                    if (!strncmp(go_cmd, "quit", 4)) { quit = 1; break; }
-                    if (!strncmp(go_cmd, "isready", 7)) {
-                        printf("readyok\n"); fflush(stdout); continue;
-                    }
-                    if (!strncmp(go_cmd, "go", 2)) { parse_go(go_cmd); break; }
-                    // Unknown command between position and go — ignore and keep reading.
-                }
-                return;
-            }
-            // Unknown/unhandled command — ignore and keep reading.
-        }
-
-        // Signal ponder search to stop and wait for it to print bestmove
-        v14_stopped = 1;
-        stopped = 1;
-        is_pondering = 0;
-        pthread_join(ponder_th, NULL);
-        return;
-    }
-
     int depth = -1;
     int wtime = -1, btime = -1, winc = 0, binc = 0;
     int movetime = -1;
@@ -5417,24 +6479,24 @@ void parse_go(char *command)
         movetime = atoi(argument + 9);
 
     int time_budget_ms = 0;
-    int search_depth = 30;
+    *search_depth = 30;
 
     if (depth != -1) {
         // Fixed depth search
-        search_depth = depth;
+        *search_depth = depth;
         time_budget_ms = 0;
     } else if (movetime != -1) {
         // Fixed time per move
         time_budget_ms = movetime;
-        search_depth = 30;
+        *search_depth = 30;
     } else {
         // Time control: use v13's allocate_time
-        int my_time = (side == white) ? wtime : btime;
-        int my_inc = (side == white) ? winc : binc;
-        int their_time = (side == white) ? btime : wtime;
+        int my_time = (pos->side == white) ? wtime : btime;
+        int my_inc = (pos->side == white) ? winc : binc;
+        int their_time = (pos->side == white) ? btime : wtime;
 
         if (my_time > 0) {
-            time_budget_ms = allocate_time(my_time, my_inc, fullmove_number, their_time);
+            time_budget_ms = allocate_time(my_time, my_inc, pos->fullmove_number, their_time);
             // Hard safety: never use more than 40% of remaining clock minus overhead
             int hard = (int)(my_time * 0.4) - 1000;
             if (hard < time_budget_ms) hard = time_budget_ms;
@@ -5444,29 +6506,57 @@ void parse_go(char *command)
                 if (hard > max_hard) hard = max_hard;
             }
             v14_hard_limit_ms = hard;
-            search_depth = 30;
+            *search_depth = 30;
         } else if (wtime >= 0 || btime >= 0) {
             // Clock sent but our time is 0 (flagged / time scramble) — return a move fast
             time_budget_ms = 100;
-            search_depth = 30;
+            *search_depth = 30;
         } else {
             // No time info at all — infinite search (e.g. "go infinite")
-            search_depth = 30;
+            *search_depth = 30;
             time_budget_ms = 0;
         }
     }
 
-    search_position(search_depth, time_budget_ms);
+    return time_budget_ms;
+}
+
+// Parse UCI "go" command with v13's time management
+void parse_go(position *pos, char *command)
+{
+    // "go ponder" = infinite search on opponent's time. The input thread ends it on
+    // "stop", or on "ponderhit" turns it into a timed search with the clock from this
+    // command, measured from the ponderhit. Either way it prints bestmove itself.
+    if (strncmp(command, "go ponder", 9) == 0) {
+        int unused_depth;
+        int budget = go_time_budget(pos, command, &unused_depth);
+        pthread_mutex_lock(&cmd_mutex);
+        ponderhit_budget_ms = budget;
+        ponderhit_hard_ms = v14_hard_limit_ms;
+        is_pondering = 1;
+        pthread_mutex_unlock(&cmd_mutex);
+
+        search_position(pos, 30, 0);
+        is_pondering = 0;
+        input_search_finished();
+        return;
+    }
+
+    int search_depth;
+    int time_budget_ms = go_time_budget(pos, command, &search_depth);
+    search_position(pos, search_depth, time_budget_ms);
+    input_search_finished();
 }
 
+
 // Opening book: simple first-move responses
-static int try_opening_book()
+static int try_opening_book(position *pos)
 {
-    if (fullmove_number != 1) return 0;
+    if (pos->fullmove_number != 1) return 0;
 
-    if (side == white) {
+    if (pos->side == white) {
         // c4 (English) is the bot's best-performing first move (58% win rate)
-        int move = parse_move("c2c4");
+        int move = parse_move(pos, "c2c4");
         if (move) {
             printf("bestmove c2c4\n");
             fflush(stdout);
@@ -5474,23 +6564,23 @@ static int try_opening_book()
         }
     } else {
         // vs e4 (white pawn on e4 = BBC sq 36) → e5
-        if (get_bit(bitboards[P], 36) && !get_bit(bitboards[P], 12)) {
-            int move = parse_move("e7e5");
+        if (get_bit(pos->bitboards[P], 36) && !get_bit(pos->bitboards[P], 12)) {
+            int move = parse_move(pos, "e7e5");
             if (move) { printf("bestmove e7e5\n"); fflush(stdout); return 1; }
         }
         // vs d4 (white pawn on d4 = BBC sq 35) → d5
-        if (get_bit(bitboards[P], 35) && !get_bit(bitboards[P], 11)) {
-            int move = parse_move("d7d5");
+        if (get_bit(pos->bitboards[P], 35) && !get_bit(pos->bitboards[P], 11)) {
+            int move = parse_move(pos, "d7d5");
             if (move) { printf("bestmove d7d5\n"); fflush(stdout); return 1; }
         }
         // vs c4 (white pawn on c4 = BBC sq 34) → e5
-        if (get_bit(bitboards[P], 34) && !get_bit(bitboards[P], 10)) {
-            int move = parse_move("e7e5");
+        if (get_bit(pos->bitboards[P], 34) && !get_bit(pos->bitboards[P], 10)) {
+            int move = parse_move(pos, "e7e5");
             if (move) { printf("bestmove e7e5\n"); fflush(stdout); return 1; }
         }
         // vs Nf3 (white knight on f3 = BBC sq 45) → d5
-        if (get_bit(bitboards[N], 45)) {
-            int move = parse_move("d7d5");
+        if (get_bit(pos->bitboards[N], 45)) {
+            int move = parse_move(pos, "d7d5");
             if (move) { printf("bestmove d7d5\n"); fflush(stdout); return 1; }
         }
     }
@@ -5503,35 +6593,34 @@ void uci_loop()
     setbuf(stdin, NULL);
     setbuf(stdout, NULL);
 
-    char input[2000];
+    // stdin belongs to the input thread from here on; commands arrive via the queue
+    pthread_t input_thread;
+    pthread_create(&input_thread, NULL, input_thread_main, NULL);
 
-    while (1) {
-        memset(input, 0, sizeof(input));
-        fflush(stdout);
+    static char input[UCI_LINE_LEN];
 
-        if (!fgets(input, 2000, stdin))
-            break;  // EOF on stdin, exit
+    // the game position the GUI sets up; searches copy it into each helper
+    static position game;
+    position *pos = &game;
 
-        // strip newline
-        char *nl = strchr(input, '\n');
-        if (nl) *nl = 0;
-
-        if (input[0] == '\0')
-            continue;
+    while (1) {
+        fflush(stdout);
+        dequeue_command(input);  // "quit" is queued on EOF as well
 
         if (strncmp(input, "isready", 7) == 0) {
+            tt_clear_wait();  // readyok promises a usable hash table
             printf("readyok\n");
             fflush(stdout);
             continue;
         }
 
         if (strncmp(input, "position", 8) == 0) {
-            parse_position(input);
+            parse_position(pos, input);
             continue;
         }
 
         if (strncmp(input, "ucinewgame", 10) == 0) {
-            parse_position("position startpos");
+            parse_position(pos, "position startpos");
             clear_hash_table();
 #ifndef TUNER
             memset(corr_hist, 0, sizeof(corr_hist));
@@ -5541,8 +6630,8 @@ void uci_loop()
 
         if (strncmp(input, "go", 2) == 0) {
             // Try opening book first
-            if (!try_opening_book())
-                parse_go(input);
+            if (!try_opening_book(pos))
+                parse_go(pos, input);
             if (quit) break;
             continue;
         }
@@ -5553,26 +6642,50 @@ void uci_loop()
         if (strncmp(input, "perft", 5) == 0) {
             nodes = 0;
             int depth = atoi(input + 6);
-            perft_test(depth);
+            perft_test(pos, depth);
             continue;
         }
 
         if (strncmp(input, "eval", 4) == 0) {
-            printf("eval: %d\n", evaluate());
+            printf("eval: %d\n", evaluate(pos));
             fflush(stdout);
             continue;
         }
 
-        if (strncmp(input, "stop", 4) == 0)
-            continue;  // No-op when not searching
+        if (strncmp(input, "stop", 4) == 0 || strncmp(input, "ponderhit", 9) == 0)
+            continue;  // arrived after the search already ended
+
+        if (strncmp(input, "stats", 5) == 0) {
+            // Cache statistics of the last search (all threads)
+            const cache_stats *st = &last_search_stats;
+            tt_clear_wait();
+            printf("info string tt size %llu MB clusters %llu hashfull %d\n",
+                   (unsigned long long)(tt_num_clusters * sizeof(tt_cluster) >> 20),
+                   (unsigned long long)tt_num_clusters, tt_hashfull());
+            printf("info string tt probes %llu hits %llu collisions %llu\n",
+                   st->tt_probes, st->tt_hits, st->tt_collisions);
+            printf("info string evalcache probes %llu hits %llu\n", st->eval_probes, st->eval_hits);
+            printf("info string pawn probes %llu hits %llu (%d entries)\n",
+                   st->pawn_probes, st->pawn_hits, PAWN_HASH_SIZE);
+            print_cache_stats(st);
+            fflush(stdout);
+            continue;
+        }
 
         if (strncmp(input, "setoption", 9) == 0) {
             if (strstr(input, "name Threads value")) {
                 char *val = strstr(input, "value");
                 if (val) {
                     int t = atoi(val + 6);
-                    if (t >= 1 && t <= MAX_THREADS)
-                        num_threads = t;
+                    if (t >= 1 && t <= max_threads)
+                        thread_pool_init(t);
+                }
+            } else if (strstr(input, "name Hash value")) {
+                char *val = strstr(input, "value");
+                if (val) {
+                    int mb = atoi(val + 6);
+                    if (mb >= 1 && mb <= TT_MAX_MB)
+                        init_hash_table(mb);
                 }
 #ifndef TUNER
             } else if (strstr(input, "name SyzygyPath value")) {
@@ -5592,7 +6705,8 @@ void uci_loop()
         if (strncmp(input, "uci", 3) == 0) {
             printf("id name v28\n");
             printf("id author tomberkley\n");
-            printf("option name Threads type spin default 1 min 1 max %d\n", MAX_THREADS);
+            printf("option name Hash type spin default %d min 1 max %d\n", TT_DEFAULT_MB, TT_MAX_MB);
+            printf("option name Threads type spin default 1 min 1 max %d\n", max_threads);
             printf("option name UCI_Ponder type check default false\n");
             printf("option name SyzygyPath type string default <empty>\n");
             printf("uciok\n");
@@ -5615,10 +6729,15 @@ void init_all()
     init_leapers_attacks();
     init_sliders_attacks(bishop);
     init_sliders_attacks(rook);
+    init_line_tables();
     init_random_keys();
     init_evaluation_masks();
+    init_piece_square_tables();
     init_lmr_table();
-    clear_hash_table();
+    max_threads = hardware_threads();
+    if (max_threads < 8) max_threads = 8;
+    if (max_threads > THREADS_LIMIT) max_threads = THREADS_LIMIT;
+    init_hash_table(TT_DEFAULT_MB);
 }
 
 #ifdef TUNER
@@ -5653,16 +6772,19 @@ static void load_dataset(const char *path) {
     fflush(stdout);
 }
 
-static int eval_white_perspective() {
-    int e = evaluate();
-    return (side == white) ? e : -e;
+static int eval_white_perspective(position *pos) {
+    int e = evaluate(pos);
+    return (pos->side == white) ? e : -e;
 }
 
 static double compute_mse() {
+    static position scratch;  // reloaded from each dataset FEN
+    position *pos = &scratch;
     double err = 0.0;
+    init_piece_square_tables();  // tp[] changed since the last pass
     for (int i = 0; i < dataset_size; i++) {
-        parse_fen(dataset[i].fen);
-        double sig = 1.0 / (1.0 + pow(10.0, -(double)eval_white_perspective() / K_SCALE));
+        parse_fen(pos, dataset[i].fen);
+        double sig = 1.0 / (1.0 + pow(10.0, -(double)eval_white_perspective(pos) / K_SCALE));
         double d = sig - (double)dataset[i].result;
         err += d * d;
     }
@@ -5866,7 +6988,9 @@ int main(int argc, char *argv[])
     run_tuner();
 #else
     (void)argc; (void)argv;
+    thread_pool_init(1);  // context for the main search thread
     uci_loop();
+    thread_pool_init(1);  // park and join the helpers before exit
 #endif
     return 0;
 }